@@ -0,0 +1,24 @@
+; A pointer computed by integer arithmetic may point into the object of another pointer.
+; The store via %q may overwrite %g, so the load of %g must not be folded to 1.
+; CANARY: -emit-alias-scopes=64
+; EXPECT-NOT: ret i32 1
+
+define i32 @f(i32* %p) {
+entry:
+  %a = ptrtoint i32* %p to i64
+  %b = add i64 %a, 4
+  %q = inttoptr i64 %b to i32*
+  %g = getelementptr inbounds i32, i32* %p, i64 1
+  store i32 1, i32* %g, align 4
+  store i32 2, i32* %q, align 4
+  %r = load i32, i32* %g, align 4
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  %arr = alloca [2 x i32], align 4
+  %p = getelementptr inbounds [2 x i32], [2 x i32]* %arr, i64 0, i64 0
+  %r = call i32 @f(i32* %p)
+  ret i32 %r
+}
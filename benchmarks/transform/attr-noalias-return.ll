@@ -0,0 +1,40 @@
+; @mk returns the result of a call through a pointer, which dyck-aa resolves to @alloc and @zalloc.
+; Both return fresh heap objects, so the return of @mk is noalias, and the store via %m cannot modify %p.
+; CANARY: -infer-function-attrs
+; EXPECT: ret i32 1
+
+@fns = constant [2 x i8* (i64)*] [i8* (i64)* @alloc, i8* (i64)* @zalloc]
+
+declare noalias i8* @malloc(i64)
+
+declare noalias i8* @calloc(i64, i64)
+
+define i8* @alloc(i64 %n) noinline {
+entry:
+  %m = call i8* @malloc(i64 %n)
+  ret i8* %m
+}
+
+define i8* @zalloc(i64 %n) noinline {
+entry:
+  %m = call i8* @calloc(i64 1, i64 %n)
+  ret i8* %m
+}
+
+define i8* @mk(i64 %n, i64 %k) noinline {
+entry:
+  %pp = getelementptr inbounds [2 x i8* (i64)*], [2 x i8* (i64)*]* @fns, i64 0, i64 %k
+  %fp = load i8* (i64)*, i8* (i64)** %pp, align 8
+  %m = call i8* %fp(i64 %n)
+  ret i8* %m
+}
+
+define i32 @test(i32* %p, i64 %k) {
+entry:
+  %m = call i8* @mk(i64 4, i64 %k)
+  %q = bitcast i8* %m to i32*
+  store i32 1, i32* %p, align 4
+  store i32 2, i32* %q, align 4
+  %v = load i32, i32* %p, align 4
+  ret i32 %v
+}
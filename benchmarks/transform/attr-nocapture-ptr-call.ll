@@ -0,0 +1,40 @@
+; @g only passes %q to the functions in @fns through a pointer, which dyck-aa resolves to @set and @get.
+; Neither captures its argument, so %q of @g is nocapture, and @ext cannot modify %a.
+; CANARY: -infer-function-attrs
+; EXPECT: ret i32 7
+
+@fns = constant [2 x void (i32*)*] [void (i32*)* @set, void (i32*)* @get]
+@sink = global i32 0
+
+declare void @ext()
+
+define void @set(i32* %q) noinline {
+entry:
+  store i32 0, i32* %q, align 4
+  ret void
+}
+
+define void @get(i32* %q) noinline {
+entry:
+  %v = load i32, i32* %q, align 4
+  store i32 %v, i32* @sink, align 4
+  ret void
+}
+
+define void @g(i32* %q, i64 %k) noinline {
+entry:
+  %pp = getelementptr inbounds [2 x void (i32*)*], [2 x void (i32*)*]* @fns, i64 0, i64 %k
+  %fp = load void (i32*)*, void (i32*)** %pp, align 8
+  call void %fp(i32* %q)
+  ret void
+}
+
+define i32 @test(i64 %k) {
+entry:
+  %a = alloca i32, align 4
+  call void @g(i32* %a, i64 %k)
+  store i32 7, i32* %a, align 4
+  call void @ext()
+  %v = load i32, i32* %a, align 4
+  ret i32 %v
+}
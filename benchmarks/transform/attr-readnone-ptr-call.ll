@@ -0,0 +1,34 @@
+; @f only calls the functions in @fns through a pointer, which dyck-aa resolves to @inc and @dbl.
+; Neither accesses memory, so @f is readnone, and the load of %p is folded across the call.
+; CANARY: -infer-function-attrs
+; EXPECT: ret i32 1
+
+@fns = constant [2 x i32 (i32)*] [i32 (i32)* @inc, i32 (i32)* @dbl]
+
+define i32 @inc(i32 %x) noinline {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @dbl(i32 %x) noinline {
+entry:
+  %r = shl i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @f(i64 %k, i32 %x) noinline {
+entry:
+  %pp = getelementptr inbounds [2 x i32 (i32)*], [2 x i32 (i32)*]* @fns, i64 0, i64 %k
+  %fp = load i32 (i32)*, i32 (i32)** %pp, align 8
+  %r = call i32 %fp(i32 %x)
+  ret i32 %r
+}
+
+define i32 @test(i32* %p, i64 %k) {
+entry:
+  store i32 1, i32* %p, align 4
+  %r = call i32 @f(i64 %k, i32 0)
+  %v = load i32, i32* %p, align 4
+  ret i32 %v
+}
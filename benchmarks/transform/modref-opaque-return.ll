@@ -0,0 +1,21 @@
+; The pointer returned by an unmodeled external function is untracked, so a call that writes any memory
+; may modify and read it. Both queries, the store and the load of %e against the call to @clear, must report so.
+; CANARY: -check-dyck-modref
+; EXPECT-LOG: Checked 2 call site mod/ref queries, 0 missed.
+
+declare i32* @__errno_location()
+
+define void @clear(i32* %p) noinline {
+entry:
+  store i32 0, i32* %p, align 4
+  ret void
+}
+
+define i32 @test(i32* %q) {
+entry:
+  %e = call i32* @__errno_location()
+  store i32 1, i32* %e, align 4
+  call void @clear(i32* %q)
+  %v = load i32, i32* %e, align 4
+  ret i32 %v
+}
@@ -0,0 +1,26 @@
+; A null argument flows into %p, so %p may be null, while only @G flows into %q, so %q is not null.
+; CANARY: -print-nca-stats
+; EXPECT-LOG: # deref pointers: 3, # not-null by NFA: 1,
+
+@G = global i32 0, align 4
+
+define i32 @f(i32* %p) {
+entry:
+  %x = load i32, i32* %p, align 4
+  store i32 %x, i32* %p, align 4
+  ret i32 %x
+}
+
+define i32 @g(i32* %q) {
+entry:
+  %r = load i32, i32* %q, align 4
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  %a = call i32 @f(i32* null)
+  %b = call i32 @g(i32* @G)
+  %r = add i32 %a, %b
+  ret i32 %r
+}
@@ -0,0 +1,21 @@
+; Run by opt with dyck-aa in the alias analysis pipeline. %a and %b are different allocas, and @f is only called
+; with them, so dyck-aa knows %p and %q do not alias, which basic-aa cannot tell. GVN then folds the load of %p.
+; OPT: -aa-pipeline=dyck-aa,basic-aa -passes='require<dyck-aa>,function(gvn)'
+; EXPECT: ret i32 1
+; EXPECT-LOG: Running DyckAA takes
+
+define i32 @f(i32* %p, i32* %q) {
+entry:
+  store i32 1, i32* %p, align 4
+  store i32 2, i32* %q, align 4
+  %v = load i32, i32* %p, align 4
+  ret i32 %v
+}
+
+define i32 @main() {
+entry:
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %r = call i32 @f(i32* %a, i32* %b)
+  ret i32 %r
+}
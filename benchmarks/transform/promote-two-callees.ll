@@ -0,0 +1,32 @@
+; The pointer call in @f is resolved to @inc and @dbl. With at most two targets promoted, it becomes
+; two guarded direct calls, and the indirect call stays as the fallback when neither guard holds.
+; @fns is not constant, otherwise opt folds the guards on the loaded pointer into a switch on %k.
+; CANARY: -promote-indirect-calls=2
+; EXPECT-LOG: Promoted 1 of 1 pointer calls to 2 guarded direct calls.
+; EXPECT: icmp eq i32 (i32)* %fp, @inc
+; EXPECT: icmp eq i32 (i32)* %fp, @dbl
+; EXPECT: call i32 @inc(i32 %x)
+; EXPECT: call i32 @dbl(i32 %x)
+; EXPECT: call i32 %fp(i32 %x)
+
+@fns = global [2 x i32 (i32)*] [i32 (i32)* @inc, i32 (i32)* @dbl]
+
+define i32 @inc(i32 %x) noinline {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @dbl(i32 %x) noinline {
+entry:
+  %r = shl i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @f(i64 %k, i32 %x) {
+entry:
+  %pp = getelementptr inbounds [2 x i32 (i32)*], [2 x i32 (i32)*]* @fns, i64 0, i64 %k
+  %fp = load i32 (i32)*, i32 (i32)** %pp, align 8
+  %r = call i32 %fp(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,67 @@
+executable=$1
+opt=$2
+ll_dir=$3
+benchmarks_bin_dir=$4
+plugin=$5
+
+# each case is transformed by canary with the options in its "; CANARY:" line, optimized by opt -O2,
+# and the result must contain every line given by "; EXPECT:" and none given by "; EXPECT-NOT:",
+# and the output of canary must contain every line given by "; EXPECT-LOG:".
+# a case with an "; OPT:" line is instead run by opt with the dyck-aa plugin and the options in the line
+echo "[INFO] ----------------------------------------------------"
+echo "[INFO] Regression begins (transform)"
+echo "[INFO] ----------------------------------------------------"
+
+rm -f $benchmarks_bin_dir/*.log
+rm -f $benchmarks_bin_dir/*.err
+
+failed=0
+for ll in $ll_dir/*.ll;
+do
+  proj=`basename $ll`
+  printf "Running %30s" "$proj"
+
+  options=`sed -n 's/^; CANARY: //p' $ll`
+  opt_options=`sed -n 's/^; OPT: //p' $ll`
+  if [ -n "$opt_options" ]; then
+    eval $opt -load-pass-plugin=$plugin $opt_options $ll -S -o $benchmarks_bin_dir/$proj.opt.ll \
+      >>$benchmarks_bin_dir/$proj.log 2>$benchmarks_bin_dir/$proj.err
+  else
+    $executable $ll $options -o $benchmarks_bin_dir/$proj.bc >>$benchmarks_bin_dir/$proj.log 2>$benchmarks_bin_dir/$proj.err \
+      && $opt -passes='default<O2>' $benchmarks_bin_dir/$proj.bc -S -o $benchmarks_bin_dir/$proj.opt.ll 2>>$benchmarks_bin_dir/$proj.err
+  fi
+  ret=$?
+
+  if [ $ret -eq 0 ]; then
+    while IFS= read -r expected; do
+      if ! grep -qF -- "$expected" $benchmarks_bin_dir/$proj.opt.ll; then
+        echo "missing: $expected" >>$benchmarks_bin_dir/$proj.err
+        ret=1
+      fi
+    done < <(sed -n 's/^; EXPECT: //p' $ll)
+    while IFS= read -r unexpected; do
+      if grep -qF -- "$unexpected" $benchmarks_bin_dir/$proj.opt.ll; then
+        echo "unexpected: $unexpected" >>$benchmarks_bin_dir/$proj.err
+        ret=1
+      fi
+    done < <(sed -n 's/^; EXPECT-NOT: //p' $ll)
+    while IFS= read -r logged; do
+      if ! grep -qF -- "$logged" $benchmarks_bin_dir/$proj.log; then
+        echo "missing in log: $logged" >>$benchmarks_bin_dir/$proj.err
+        ret=1
+      fi
+    done < <(sed -n 's/^; EXPECT-LOG: //p' $ll)
+  fi
+
+  if [ $ret -ne 0 ]; then
+    printf "\tFail!\n"
+    failed=1
+  else
+    printf "\tPass!\n"
+  fi
+done
+
+echo "[INFO] ----------------------------------------------------"
+echo "[INFO] Regression completes (transform)"
+echo "[INFO] ----------------------------------------------------"
+exit $failed
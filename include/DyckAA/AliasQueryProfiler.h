@@ -0,0 +1,115 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DYCKAA_ALIASQUERYPROFILER_H
+#define DYCKAA_ALIASQUERYPROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/// An opt-in profiler of the alias query api, enabled by -dyckaa-profile-queries=<file>.
+/// It counts the calls, latencies and sizes of the queried classes of each api, and
+/// the calls of each client. The report is written to the file at exit.
+class AliasQueryProfiler {
+public:
+    enum QueryKind {
+        QK_MayAlias, QK_AliasSet, QK_MayNull, QK_MayAliasBatch, QK_PointsTo, QK_NumKinds
+    };
+
+    /// histograms use log2 buckets, the K-th bucket counts values in [2^K, 2^(K+1))
+    static const unsigned NumBuckets = 32;
+
+    /// the report file, empty if profiling is disabled
+    static std::string ReportFile;
+
+    static bool enabled() { return !ReportFile.empty(); }
+
+    static AliasQueryProfiler &get();
+
+    /// records one query from its construction to its destruction
+    class Sample {
+    private:
+        QueryKind Kind;
+        bool Enabled;
+        unsigned long ClassSize = 0;
+        std::chrono::steady_clock::time_point Begin;
+
+    public:
+        explicit Sample(QueryKind K) : Kind(K), Enabled(enabled()) {
+            if (Enabled) Begin = std::chrono::steady_clock::now();
+        }
+
+        ~Sample() {
+            if (Enabled) get().record(Kind, std::chrono::steady_clock::now() - Begin, ClassSize);
+        }
+
+        void setClassSize(unsigned long Size) { ClassSize = Size; }
+    };
+
+    /// attributes the queries of the current thread to \p Client during its lifetime,
+    /// the client is usually the name of the calling pass
+    class ClientScope {
+    private:
+        void *Prev = nullptr;
+
+    public:
+        explicit ClientScope(const char *Client);
+
+        ~ClientScope();
+    };
+
+private:
+    struct Histogram {
+        std::atomic<unsigned long> Buckets[NumBuckets] = {};
+
+        void add(unsigned long Value);
+    };
+
+    struct KindStats {
+        std::atomic<unsigned long> Count{0};
+        std::atomic<unsigned long> TotalNanos{0};
+        Histogram Latency;
+        Histogram ClassSize;
+    };
+
+    struct ClientStats {
+        std::atomic<unsigned long> Count[QK_NumKinds] = {};
+    };
+
+    KindStats Stats[QK_NumKinds];
+
+    std::mutex ClientsMutex;
+    std::map<std::string, std::unique_ptr<ClientStats>> Clients;
+    ClientStats *Unattributed;
+
+    AliasQueryProfiler();
+
+    ~AliasQueryProfiler();
+
+    void record(QueryKind, std::chrono::steady_clock::duration, unsigned long ClassSize);
+
+    ClientStats *getClient(const std::string &Client);
+
+    void printReport();
+};
+
+#endif // DYCKAA_ALIASQUERYPROFILER_H
@@ -0,0 +1,111 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DYCKAA_DYCKAARESULT_H
+#define DYCKAA_DYCKAARESULT_H
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueHandle.h>
+#include <memory>
+#include <vector>
+#include "DyckAA/DyckAliasAnalysis.h"
+
+using namespace llvm;
+
+/// DyckAA as an LLVM alias analysis, so that LLVM's own passes can use it via AAManager.
+///
+/// Pointers in the same alias class point to the same objects, and a pointer to a struct field
+/// is connected to the struct pointer by an offset edge. Thus, two pointers may point to
+/// overlapping memory only if their classes are in the same component of offset edges.
+///
+/// The result maps values to classes by their addresses. Values deleted after the analysis are
+/// forgotten, so that they and new values at their addresses are regarded as unknown, as are all other
+/// values created after the analysis. Thus, like GlobalsAA, the result is kept until it is abandoned,
+/// which a transformation that changes existing pointers in a way that breaks the result should do
+/// via PreservedAnalyses::abandon<DyckAA>().
+class DyckAAResult : public AAResultBase<DyckAAResult> {
+    friend AAResultBase<DyckAAResult>;
+
+private:
+    std::shared_ptr<DyckAliasAnalysis> DAA;
+
+    /// the alias classes of the objects that pointers in each offset component point to
+    std::vector<std::vector<unsigned>> ComponentObjects;
+
+    /// alias classes reachable from global values
+    BitVector GlobalReachable;
+
+    /// records a value when it is deleted
+    class DeletionHandle : public CallbackVH {
+        DenseSet<const Value *> *Deleted;
+
+    public:
+        DeletionHandle(Value *V, DenseSet<const Value *> *Deleted) : CallbackVH(V), Deleted(Deleted) {}
+
+        void deleted() override {
+            Deleted->insert(getValPtr());
+            setValPtr(nullptr);
+        }
+    };
+
+    /// on the heap, so that the handles still refer to them after the result is moved
+    /// @{
+    std::unique_ptr<DenseSet<const Value *>> Deleted;
+    std::unique_ptr<std::vector<DeletionHandle>> Handles;
+    /// @}
+
+public:
+    explicit DyckAAResult(std::shared_ptr<DyckAliasAnalysis> DAA);
+
+    DyckAAResult(DyckAAResult &&) = default;
+
+    AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB, AAQueryInfo &AAQI);
+
+    ModRefInfo getModRefInfo(const CallBase *Call, const MemoryLocation &Loc, AAQueryInfo &AAQI);
+
+    using AAResultBase::getModRefInfo;
+
+    /// return true only if the result is explicitly abandoned
+    bool invalidate(Module &M, const PreservedAnalyses &PA, ModuleAnalysisManager::Invalidator &Inv);
+
+    DyckAliasAnalysis *getDyckAliasAnalysis() const { return DAA.get(); }
+
+private:
+    /// the class of \p V, InvalidClassID if \p V is not known or its address is that of a deleted value
+    unsigned getAliasClassID(const Value *V) const;
+
+    /// mark the classes reachable from \p Sources in \p Reachable, stop early if any class in \p Targets is found
+    bool reach(const std::vector<unsigned> &Sources, BitVector &Reachable, const std::vector<unsigned> *Targets) const;
+};
+
+/// The new-pm analysis that runs DyckAA on a module
+class DyckAA : public AnalysisInfoMixin<DyckAA> {
+    friend AnalysisInfoMixin<DyckAA>;
+
+    static AnalysisKey Key;
+
+public:
+    typedef DyckAAResult Result;
+
+    DyckAAResult run(Module &M, ModuleAnalysisManager &MAM);
+};
+
+#endif // DYCKAA_DYCKAARESULT_H
@@ -20,6 +20,9 @@
 #define DYCKAA_DYCKALIASANALYSIS_H
 
 #include <llvm/Pass.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/ErrorHandling.h>
@@ -39,7 +42,34 @@ private:
     DyckGraph *DyckPTG;
     DyckCallGraph *DyckCG;
 
+    /// The frozen query surface, built once after solving
+    /// @{
+    DenseMap<const Value *, unsigned> ValueClassMap;
+    DenseMap<const DyckGraphNode *, unsigned> NodeClassMap;
+    std::vector<DyckGraphNode *> ClassNodes;
+    /// members of class K are ClassMembers[ClassOffsets[K], ClassOffsets[K + 1])
+    std::vector<Value *> ClassMembers;
+    std::vector<unsigned> ClassOffsets;
+    BitVector ClassMayNull;
+    /// the class each class points to, InvalidClassID if it does not point to anything
+    std::vector<unsigned> ClassPointsTo;
+    /// fields of class K are ClassFields[ClassFieldOffsets[K], ClassFieldOffsets[K + 1]),
+    /// each is a pair of (field index, field class), sorted by the field index
+    std::vector<std::pair<long, unsigned>> ClassFields;
+    std::vector<unsigned> ClassFieldOffsets;
+    /// the component of each class, where classes are connected by offset edges
+    std::vector<unsigned> ClassOffsetComponents;
+    unsigned NumOffsetComponents = 0;
+    /// components that may contain pointers the analysis cannot track
+    BitVector OpaqueComponents;
+    /// whether only a slice of the module is analyzed, values outside the slice have no class
+    bool Sliced = false;
+    /// @}
+
 public:
+    /// the class id of values that are not known by the analysis
+    static const unsigned InvalidClassID = ~0U;
+
     static char ID;
 
     DyckAliasAnalysis();
@@ -50,14 +80,72 @@ public:
 
     void getAnalysisUsage(AnalysisUsage &AU) const override;
 
-    /// get alias set of a pointer \p Ptr
-    const std::set<Value *> *getAliasSet(Value *Ptr) const;
+    /// The following queries do not change the analysis results,
+    /// so they are safe to be called in parallel.
+    /// Callers may attribute their queries via AliasQueryProfiler::ClientScope.
+    /// @{
+    /// get alias set of a pointer \p Ptr, empty if \p Ptr is not known by the analysis
+    ArrayRef<Value *> getAliasSet(const Value *Ptr) const;
 
     /// return true if \p V1 is an alias of \p V2
-    bool mayAlias(Value *V1, Value *V2) const;
+    bool mayAlias(const Value *V1, const Value *V2) const;
 
     /// return true if \p V is an alias of nullptr
-    bool mayNull(Value *V) const;
+    bool mayNull(const Value *V) const;
+
+    /// get the dense id of the alias class of \p V, InvalidClassID if \p V is not known
+    unsigned getAliasClassID(const Value *V) const;
+
+    /// get the dense id of the alias class represented by \p N, InvalidClassID if \p N is not in the graph
+    unsigned getAliasClassID(const DyckGraphNode *N) const;
+
+    /// get the vertex representing the alias class \p ID
+    DyckGraphNode *getAliasClassNode(unsigned ID) const { return ClassNodes[ID]; }
+
+    /// get the values in the alias class \p ID
+    ArrayRef<Value *> getAliasClassMembers(unsigned ID) const {
+        return {ClassMembers.data() + ClassOffsets[ID], ClassMembers.data() + ClassOffsets[ID + 1]};
+    }
+
+    /// return true if the alias class \p ID may contain nullptr
+    bool mayNullClass(unsigned ID) const { return ClassMayNull.test(ID); }
+
+    /// get the class of the objects that class \p ID points to, InvalidClassID if none
+    unsigned pointsToClass(unsigned ID) const { return ClassPointsTo[ID]; }
+
+    /// get the (field index, field class) pairs of the objects in class \p ID, sorted by the index
+    ArrayRef<std::pair<long, unsigned>> getClassFields(unsigned ID) const {
+        return {ClassFields.data() + ClassFieldOffsets[ID], ClassFields.data() + ClassFieldOffsets[ID + 1]};
+    }
+
+    /// get the class of the objects that \p V points to, InvalidClassID if none
+    unsigned pointsTo(const Value *V) const;
+
+    /// get the class of the field \p FieldIdx of the objects that \p V points to, InvalidClassID if none
+    unsigned pointsToField(const Value *V, long FieldIdx) const;
+
+    /// a pointer to a struct field is connected to the struct pointer by an offset edge, so two pointers
+    /// may point to overlapping memory only if their classes are in the same offset component
+    unsigned getOffsetComponent(unsigned ID) const { return ClassOffsetComponents[ID]; }
+
+    /// the number of offset components, component ids are in [0, getNumOffsetComponents())
+    unsigned getNumOffsetComponents() const { return NumOffsetComponents; }
+
+    /// return true if the pointers in the offset component \p CompID may be computed from integers or
+    /// returned by external functions that are not modeled, which may point to anything
+    bool isOpaqueComponent(unsigned CompID) const { return OpaqueComponents.test(CompID); }
+
+    /// the number of alias classes, class ids are in [0, getNumAliasClasses())
+    unsigned getNumAliasClasses() const { return ClassOffsets.empty() ? 0 : ClassOffsets.size() - 1; }
+
+    /// the K-th bit of the result is set if the two values of the K-th pair may alias
+    BitVector mayAliasBatch(ArrayRef<std::pair<const Value *, const Value *>> Pairs) const;
+
+    /// return the class ids of all pointer operands in \p F, in instruction and operand order.
+    /// Two operands may alias iff they have the same id. A value not known by the analysis gets
+    /// a fresh id no less than getNumAliasClasses(). If \p Pointers is given, the operands are put into it.
+    std::vector<unsigned> aliasPartition(const Function &F, std::vector<const Value *> *Pointers = nullptr) const;
+    /// @}
 
     /// get the call graph based on dyck-aa
     DyckCallGraph *getDyckCallGraph() const;
@@ -66,12 +154,19 @@ public:
     DyckGraph *getDyckGraph() const;
 
 private:
-    /// Three kinds of information will be printed.
-    /// 1. Alias Sets will be printed to the console
+    /// build the frozen query surface from the solved graph, the classes are numbered in a stable order
+    void freeze(Module &M, const std::vector<Value *> &OpaqueValues);
+
+    /// compare the batch query api against the scalar one
+    void benchmarkBatchQueries(Module &M) const;
+
+    /// Four kinds of information will be printed, the first three in parallel.
+    /// 1. Alias Sets will be output into "alias_sets.log"
     /// 2. The relation of Alias Sets will be output into "alias_rel.dot"
     /// 3. The evaluation results will be output into "distribution.log"
-    ///     The summary of the evaluation will be printed to the console
-    void printAliasSetInformation();
+    /// 4. The summary of the evaluation will be output into "alias_summary.json"
+    ///     and printed to the console
+    void printAliasSetInformation(const Module &);
 };
 
 #endif // DYCKAA_DYCKALIASANALYSIS_H
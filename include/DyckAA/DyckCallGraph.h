@@ -19,6 +19,9 @@
 #ifndef DYCKAA_DYCKCALLGRAPH_H
 #define DYCKAA_DYCKCALLGRAPH_H
 
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/SparseBitVector.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/GraphTraits.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SmallVector.h>
@@ -30,6 +33,7 @@
 #include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/Allocator.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/ErrorHandling.h>
 #include <llvm/Support/raw_ostream.h>
@@ -38,47 +42,114 @@
 #include <map>
 #include <vector>
 #include <cstdio>
+#include <functional>
 
 #include "DyckAA/DyckCallGraphNode.h"
 #include "Support/MapIterators.h"
 
 using namespace llvm;
 
-typedef std::map<Function *, DyckCallGraphNode *> FunctionMapTy;
+typedef std::vector<DyckCallGraphNode *> CallGraphNodeVecTy;
 
 class DyckCallGraph {
 private:
-    /// function -> call graph node
-    FunctionMapTy FunctionMap;
+    /// nodes and calls are allocated from the arenas and owned by the call graph
+    /// @{
+    SpecificBumpPtrAllocator<DyckCallGraphNode> NodeAllocator;
+    SpecificBumpPtrAllocator<CommonCall> CommonCallAllocator;
+    SpecificBumpPtrAllocator<PointerCall> PointerCallAllocator;
+    int NumCalls;
+    /// @}
+
+    /// call graph nodes indexed by their ids, in the order they are inserted
+    CallGraphNodeVecTy Nodes;
+
+    /// function -> id of its call graph node
+    DenseMap<Function *, unsigned> FunctionIDs;
 
     /// This node has edges to all external functions and those internal
     /// functions that have their address taken.
     DyckCallGraphNode *ExternalCallingNode;
 
+    /// strongly connected components in bottom-up order, i.e., callees come first
+    /// @{
+    std::vector<unsigned> NodeSCCs;
+    /// nodes of the K-th scc are SCCNodes[SCCOffsets[K], SCCOffsets[K + 1])
+    std::vector<DyckCallGraphNode *> SCCNodes;
+    std::vector<unsigned> SCCOffsets;
+    /// callers of the K-th scc are SCCCallers[SCCCallerOffsets[K], SCCCallerOffsets[K + 1])
+    std::vector<unsigned> SCCCallers;
+    std::vector<unsigned> SCCCallerOffsets;
+    /// the number of distinct callee sccs of each scc
+    std::vector<unsigned> NumSCCCallees;
+    /// the sccs that each scc may transitively call, an scc calls itself only via recursion;
+    /// sparse because most sccs reach only a small part of the graph
+    std::vector<SparseBitVector<>> SCCReachable;
+    /// @}
+
 public:
     DyckCallGraph();
 
     ~DyckCallGraph();
 
-    FunctionMapTy::iterator begin() { return FunctionMap.begin(); }
-
-    FunctionMapTy::iterator end() { return FunctionMap.end(); }
+    CallGraphNodeVecTy::iterator nodes_begin() { return Nodes.begin(); }
 
-    value_iterator<FunctionMapTy::iterator> nodes_begin() { return {FunctionMap.begin()}; }
+    CallGraphNodeVecTy::iterator nodes_end() { return Nodes.end(); }
 
-    value_iterator<FunctionMapTy::iterator> nodes_end() { return {FunctionMap.end()}; }
+    CallGraphNodeVecTy::const_iterator nodes_begin() const { return Nodes.begin(); }
 
-    value_iterator<FunctionMapTy::const_iterator> nodes_begin() const { return {FunctionMap.begin()}; }
+    CallGraphNodeVecTy::const_iterator nodes_end() const { return Nodes.end(); }
 
-    value_iterator<FunctionMapTy::const_iterator> nodes_end() const { return {FunctionMap.end()}; }
+    size_t size() const { return Nodes.size(); }
 
-    size_t size() const { return FunctionMap.size(); }
+    /// get the node by its id, ids are in [0, size())
+    DyckCallGraphNode *getNode(unsigned ID) const { return Nodes[ID]; }
 
     DyckCallGraphNode *getOrInsertFunction(Function *);
 
     DyckCallGraphNode *getFunction(Function *) const;
 
-    void dotCallGraph(const std::string &ModuleIdentifier);
+    /// create calls owned by the call graph
+    /// @{
+    CommonCall *createCommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args);
+
+    PointerCall *createPointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args);
+    /// @}
+
+    /// compute the sccs of the call graph, including the edges of pointer calls,
+    /// and the reachability between them. it should be called again if the graph changes
+    void computeSCCs();
+
+    /// the number of sccs, scc ids are in [0, getNumSCCs()) and callees have smaller ids
+    unsigned getNumSCCs() const { return SCCOffsets.empty() ? 0 : SCCOffsets.size() - 1; }
+
+    unsigned getSCCID(const DyckCallGraphNode *N) const { return NodeSCCs[N->getID()]; }
+
+    ArrayRef<DyckCallGraphNode *> getSCC(unsigned ID) const {
+        return {SCCNodes.data() + SCCOffsets[ID], SCCNodes.data() + SCCOffsets[ID + 1]};
+    }
+
+    /// return true if \p Caller may transitively call \p Callee, in O(1)
+    bool mayReach(Function *Caller, Function *Callee) const;
+
+    /// get the ids of the nodes that are the entries or transitively called by them
+    BitVector getReachableNodes(ArrayRef<Function *> Entries) const;
+
+    /// run \p Func on each scc as soon as all its callee sccs are done.
+    /// sccs without dependencies run in parallel on the thread pool.
+    /// it must not be called from a task of the thread pool
+    void forEachSCCBottomUp(const std::function<void(unsigned)> &Func) const;
+
+    /// write the call graph compactly, call sites are referred to by (caller id, instruction ordinal).
+    /// implicit calls and the calls from the external node have ordinal -1
+    void exportCallGraph(raw_ostream &OS) const;
+
+    /// write the whole graph into "<ModuleIdentifier>.maycg.dot", edges are labeled by call site ordinals
+    void dotCallGraph(const std::string &ModuleIdentifier) const;
+
+    /// write the functions that are within \p Depth calls from or to \p Focus into \p FileName,
+    /// edges are labeled by their call instructions
+    void dotCallGraphFocus(const std::string &FileName, Function *Focus, unsigned Depth) const;
 
     void printFunctionPointersInformation(const std::string &ModuleIdentifier);
 
@@ -125,7 +196,7 @@ namespace llvm {
     struct GraphTraits<DyckCallGraph *> : public GraphTraits<DyckCallGraphNode *> {
         static NodeRef getEntryNode(DyckCallGraph *CGN) { return CGN->getFunction(nullptr); }
 
-        using nodes_iterator = value_iterator<FunctionMapTy::iterator>;
+        using nodes_iterator = CallGraphNodeVecTy::iterator;
 
         static nodes_iterator nodes_begin(DyckCallGraph *CG) { return CG->nodes_begin(); }
 
@@ -136,7 +207,7 @@ namespace llvm {
     struct GraphTraits<const DyckCallGraph *> : public GraphTraits<const DyckCallGraphNode *> {
         static NodeRef getEntryNode(const DyckCallGraph *CGN) { return CGN->getFunction(nullptr); }
 
-        using nodes_iterator = value_iterator<FunctionMapTy::const_iterator>;
+        using nodes_iterator = CallGraphNodeVecTy::const_iterator;
 
         static nodes_iterator nodes_begin(const DyckCallGraph *CG) { return CG->nodes_begin(); }
 
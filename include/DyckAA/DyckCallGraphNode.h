@@ -26,6 +26,8 @@
 #include <llvm/Analysis/MemoryBuiltins.h>
 #include <llvm/Analysis/InstructionSimplify.h>
 #include <llvm/Analysis/ValueTracking.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SetVector.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/ErrorHandling.h>
@@ -61,11 +63,11 @@ protected:
     /// the arguments
     std::vector<Value *> Args;
 
-    /// unique id
+    /// unique id, dense and starting from 1 in a call graph
     int CallId;
 
 public:
-    Call(CallKind K, Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args);
+    Call(CallKind K, Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args, int ID);
 
     CallKind getKind() const { return Kind; }
 
@@ -84,7 +86,7 @@ public:
 
 class CommonCall : public Call {
 public:
-    CommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args);
+    CommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args, int ID);
 
     Function *getCalledFunction() const { return dyn_cast_or_null<Function>(CalledValue); }
 
@@ -96,19 +98,22 @@ public:
 
 class PointerCall : public Call {
 private:
-    std::set<Function *> MayAliasedCallees;
+    /// callees in the order they are found
+    SetVector<Function *> MayAliasedCallees;
 
 public:
-    PointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args);
+    PointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args, int ID);
 
-    std::set<Function *>::const_iterator begin() const { return MayAliasedCallees.begin(); }
+    SetVector<Function *>::const_iterator begin() const { return MayAliasedCallees.begin(); }
 
-    std::set<Function *>::const_iterator end() const { return MayAliasedCallees.end(); }
+    SetVector<Function *>::const_iterator end() const { return MayAliasedCallees.end(); }
 
     bool empty() const { return MayAliasedCallees.empty(); }
 
     unsigned size() const { return MayAliasedCallees.size(); }
 
+    bool mayCall(Function *F) const { return MayAliasedCallees.count(F); }
+
     void addMayAliasedFunction(Function *F) { MayAliasedCallees.insert(F); }
 
 public:
@@ -125,26 +130,31 @@ typedef std::vector<CallRecordTy> CallRecordVecTy;
 class DyckCallGraphNode {
 private:
     Function *Func;
+
+    /// dense id in the call graph, the external calling node is 0
+    unsigned ID;
+
     std::set<Value *> Rets;
 
     std::vector<Value *> Args;
     std::vector<Value *> VAArgs;
 
-    /// call instructions in the function
+    /// call instructions in the function, in the order they are added.
+    /// the calls are owned by the call graph.
     /// @{
-    std::set<CommonCall *> CommonCalls;
-    std::set<PointerCall *> PointerCalls;
-    std::map<Instruction *, Call *> InstructionCallMap;
+    std::vector<CommonCall *> CommonCalls;
+    std::vector<PointerCall *> PointerCalls;
+    DenseMap<Instruction *, Call *> InstructionCallMap;
     CallRecordVecTy CallRecords;
     /// @}
 
 public:
-    explicit DyckCallGraphNode(Function *);
-
-    ~DyckCallGraphNode();
+    DyckCallGraphNode(Function *, unsigned ID);
 
     Function *getLLVMFunction();
 
+    unsigned getID() const { return ID; }
+
     void addCommonCall(CommonCall *);
 
     void addPointerCall(PointerCall *);
@@ -165,15 +175,15 @@ public:
 
     void addCalledFunction(Call *C, DyckCallGraphNode *N) { CallRecords.emplace_back(C, N); }
 
-    std::set<CommonCall *>::const_iterator common_call_begin() const { return CommonCalls.begin(); }
+    std::vector<CommonCall *>::const_iterator common_call_begin() const { return CommonCalls.begin(); }
 
-    std::set<CommonCall *>::const_iterator common_call_end() const { return CommonCalls.end(); }
+    std::vector<CommonCall *>::const_iterator common_call_end() const { return CommonCalls.end(); }
 
     unsigned common_call_size() const { return CommonCalls.size(); }
 
-    std::set<PointerCall *>::const_iterator pointer_call_begin() const { return PointerCalls.begin(); }
+    std::vector<PointerCall *>::const_iterator pointer_call_begin() const { return PointerCalls.begin(); }
 
-    std::set<PointerCall *>::const_iterator pointer_call_end() const { return PointerCalls.end(); }
+    std::vector<PointerCall *>::const_iterator pointer_call_end() const { return PointerCalls.end(); }
 
     unsigned pointer_call_size() const { return PointerCalls.size(); }
 
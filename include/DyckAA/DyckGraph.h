@@ -19,6 +19,7 @@
 #ifndef DYCKAA_DYCKHALFGRAPH_H
 #define DYCKAA_DYCKHALFGRAPH_H
 
+#include <chrono>
 #include <stack>
 #include <unordered_map>
 
@@ -71,7 +72,8 @@ public:
 
     DyckGraphNode *findDyckVertex(void *Val);
 
-    /// Get reachable nodes
+    /// Get nodes reachable from the sources via any edges, including the sources.
+    /// The results are added to \p Reachable, whose nodes are regarded as visited
     /// @{
     void getReachableVertices(const std::set<DyckGraphNode *> &Sources, std::set<DyckGraphNode *> &Reachable);
 
@@ -82,7 +84,9 @@ public:
     /// Find the paper here: http://dl.acm.org/citation.cfm?id=2491956.2462159&coll=DL&dl=ACM&CFID=379446910&CFTOKEN=65130716 .
     /// Note that if there are two edges with the same label: a->b and a->c, b and c will be put into the same equivelant class.
     /// If the function does nothing, return true, otherwise return false.
-    bool qirunAlgorithm();
+    /// If a deadline is given, the algorithm may stop before the fixed point once the deadline passes;
+    /// a later call without a deadline continues the computation.
+    bool qirunAlgorithm(const std::chrono::steady_clock::time_point *Deadline = nullptr);
 
     /// validation
     void validation(const char *, int);
@@ -19,24 +19,50 @@
 #ifndef DYCKAA_DYCKMODREFANALYSIS_H
 #define DYCKAA_DYCKMODREFANALYSIS_H
 
+#include <llvm/ADT/SparseBitVector.h>
+#include <llvm/Analysis/AliasAnalysis.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Debug.h>
-#include <set>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include "DyckAA/DyckGraphNode.h"
 
 using namespace llvm;
 
+class DyckAliasAnalysis;
+
+/// the alias classes of the memory that a function (or a call site) may modify and read
 typedef struct ModRef {
-    std::set<DyckGraphNode *> Mods;
-    std::set<DyckGraphNode *> Refs;
+    SparseBitVector<> Mods;
+    SparseBitVector<> Refs;
 } ModRef;
 
 class DyckModRefAnalysis : public ModulePass {
 private:
+    DyckAliasAnalysis *DAA = nullptr;
+
     std::map<Function *, ModRef> Func2MR;
 
+    /// alias classes reachable from global values, which are not tracked by the summaries
+    SparseBitVector<> GlobalClasses;
+
+    /// the effects of a call site, merged from the summaries of all its callees
+    typedef struct CallSiteModRef {
+        ModRef MR;
+        /// the effects on the memory reachable from global values
+        ModRefInfo Global = ModRefInfo::NoModRef;
+        /// the effects on any memory, due to callees that are not analyzed
+        ModRefInfo Any = ModRefInfo::NoModRef;
+    } CallSiteModRef;
+
+    /// an unordered map keeps the cached entries in place while others are added
+    std::unordered_map<const CallInst *, CallSiteModRef> CallSiteCache;
+    std::mutex CallSiteCacheMutex;
+
 public:
     static char ID;
 
@@ -49,15 +75,32 @@ public:
     void getAnalysisUsage(AnalysisUsage &AU) const override;
 
 public:
-    std::set<DyckGraphNode *>::iterator mod_begin(Function *F) { return Func2MR.at(F).Mods.begin(); }
+    /// iterate the ids of the alias classes that \p F may modify/read
+    /// @{
+    SparseBitVector<>::iterator mod_begin(Function *F) { return Func2MR.at(F).Mods.begin(); }
 
-    std::set<DyckGraphNode *>::iterator mod_end(Function *F) { return Func2MR.at(F).Mods.end(); }
+    SparseBitVector<>::iterator mod_end(Function *F) { return Func2MR.at(F).Mods.end(); }
 
-    std::set<DyckGraphNode *>::iterator ref_begin(Function *F) { return Func2MR.at(F).Refs.begin(); }
+    SparseBitVector<>::iterator ref_begin(Function *F) { return Func2MR.at(F).Refs.begin(); }
 
-    std::set<DyckGraphNode *>::iterator ref_end(Function *F) { return Func2MR.at(F).Refs.end(); }
+    SparseBitVector<>::iterator ref_end(Function *F) { return Func2MR.at(F).Refs.end(); }
+    /// @}
 
     bool count(Function *F) const { return Func2MR.count(F); }
+
+    /// whether \p Call may modify/read the memory that \p Ptr points to.
+    /// the effects of a call site are computed at its first query and cached
+    ModRefInfo getModRefInfo(const CallInst *Call, const Value *Ptr);
+
+    /// the effects of a call to \p F by its attributes, \p F is nullptr if the callee is unknown
+    static ModRefInfo getAttributeModRefInfo(const CallBase *Call, const Function *F);
+
+private:
+    const CallSiteModRef &getCallSiteModRef(const CallInst *Call);
+
+    /// query each load/store in the caller of a direct call, and report the queries missing
+    /// the mod/refs of any transitive callee
+    void checkCallSiteModRefs(Module &M);
 };
 
 #endif // DYCKAA_DYCKMODREFANALYSIS_H
@@ -19,13 +19,14 @@
 #ifndef DyckAA_DYCKVFG_H
 #define DyckAA_DYCKVFG_H
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
+#include <functional>
 #include <map>
-#include <set>
-#include <unordered_map>
+#include <vector>
 #include "Support/CFG.h"
-#include "Support/MapIterators.h"
 
 using namespace llvm;
 
@@ -35,43 +36,87 @@ class DyckModRefAnalysis;
 
 class Call;
 
+class DyckCallGraph;
+
+/// the loads and stores of a function, grouped by the alias class of the accessed memory
+typedef struct MemoryAccesses {
+    std::map<unsigned, std::vector<LoadInst *>> Loads;
+    std::map<unsigned, std::vector<StoreInst *>> Stores;
+    /// the classes loaded/stored here that are also in the ref/mod summary, i.e., those a call may pass
+    /// into/out of the function, sorted
+    /// @{
+    std::vector<unsigned> Inputs;
+    std::vector<unsigned> Outputs;
+    /// @}
+} MemoryAccesses;
+
+typedef std::map<Function *, MemoryAccesses> FunctionMemoryAccessesTy;
+
 class DyckVFGNode {
+    friend class DyckVFG;
+
+public:
+    /// labeled edge, 0 - epsilon, pos - call, neg - return
+    typedef std::pair<DyckVFGNode *, int> EdgeTy;
+
 private:
-    /// the value this node represents
+    /// the value this node represents, null for the memory nodes of a call
     Value *V;
 
-    /// labeled edge, 0 - epsilon, pos - call, neg - return
+    /// dense id in the graph
+    unsigned ID;
+
+    /// the edges are spans of the csr arrays of the graph, sorted by the node ids, set when the graph is frozen
     /// @{
-    using EdgeSetTy = std::set<std::pair<DyckVFGNode *, int>>;
-    EdgeSetTy Targets;
-    EdgeSetTy Sources;
+    const EdgeTy *TargetsBegin = nullptr;
+    const EdgeTy *TargetsEnd = nullptr;
+    const EdgeTy *SourcesBegin = nullptr;
+    const EdgeTy *SourcesEnd = nullptr;
     /// @}
 
 public:
-    explicit DyckVFGNode(Value *V) : V(V) {}
-
-    void addTarget(DyckVFGNode *N, int L = 0) {
-        assert(N);
-        this->Targets.emplace(N, L);
-        N->Sources.emplace(this, L);
-    }
+    DyckVFGNode(Value *V, unsigned ID) : V(V), ID(ID) {}
 
     Value *getValue() const { return V; }
 
+    unsigned getID() const { return ID; }
+
     Function *getFunction() const;
 
-    EdgeSetTy::const_iterator begin() const { return Targets.begin(); }
+    const EdgeTy *begin() const { return TargetsBegin; }
 
-    EdgeSetTy::const_iterator end() const { return Targets.end(); }
+    const EdgeTy *end() const { return TargetsEnd; }
 
-    EdgeSetTy::const_iterator in_begin() const { return Sources.begin(); }
+    const EdgeTy *in_begin() const { return SourcesBegin; }
 
-    EdgeSetTy::const_iterator in_end() const { return Sources.end(); }
+    const EdgeTy *in_end() const { return SourcesEnd; }
 };
 
+/// an edge found during construction, the edges are frozen into csr arrays at last
+typedef struct VFGEdge {
+    DyckVFGNode *From;
+    DyckVFGNode *To;
+    int Label;
+} VFGEdge;
+
 class DyckVFG {
 private:
-    std::unordered_map<Value *, DyckVFGNode *> ValueNodeMap;
+    /// nodes are only created before any edge is found, so pointers to them are stable afterwards
+    std::vector<DyckVFGNode> Nodes;
+
+    DenseMap<Value *, unsigned> ValueNodeMap;
+
+    /// the nodes of (call, alias class), through which the memory of the class flows into or out of the callees
+    /// @{
+    std::map<std::pair<Call *, unsigned>, unsigned> CallInputNodes;
+    std::map<std::pair<Call *, unsigned>, unsigned> CallOutputNodes;
+    /// @}
+
+    /// the out edges and in edges of all nodes, indexed by the node id
+    /// @{
+    std::vector<DyckVFGNode::EdgeTy> Targets;
+    std::vector<DyckVFGNode::EdgeTy> Sources;
+    /// @}
 
 public:
     DyckVFG(DyckAliasAnalysis *DAA, DyckModRefAnalysis *DMRA, Module *M);
@@ -80,18 +125,36 @@ public:
 
     DyckVFGNode *getVFGNode(Value *) const;
 
-    value_iterator<std::unordered_map<Value *, DyckVFGNode *>::iterator> node_begin() { return {ValueNodeMap.begin()}; }
+    /// the number of nodes, node ids are in [0, getNumNodes())
+    unsigned getNumNodes() const { return Nodes.size(); }
 
-    value_iterator<std::unordered_map<Value *, DyckVFGNode *>::iterator> node_end() { return {ValueNodeMap.end()}; }
+    DyckVFGNode *getNode(unsigned ID) const { return const_cast<DyckVFGNode *>(&Nodes[ID]); }
 
 private:
     DyckVFGNode *getOrCreateVFGNode(Value *);
 
-    void connect(DyckModRefAnalysis *, Call *, Function *, CFG *);
+    /// create the nodes used by the local VFG of a function
+    void createVFGNodes(Function &);
+
+    /// create the nodes used to connect a call to the callee
+    void createVFGNodes(const FunctionMemoryAccessesTy &, Call *, Function *Callee);
+
+    /// the edges below are put in the buffer, so that functions can be handled in parallel
+    /// @{
+    void connect(DyckModRefAnalysis *, const FunctionMemoryAccessesTy &, Call *, Function *, CFG *,
+                 std::vector<VFGEdge> &) const;
+
+    void buildLocalVFG(DyckAliasAnalysis *DAA, CFG *CtrlFlow, Function *F, std::vector<VFGEdge> &) const;
+
+    void buildLocalVFG(Function &, std::vector<VFGEdge> &) const;
+    /// @}
+
+    /// sort and deduplicate the edges into the csr arrays
+    void freeze(std::vector<VFGEdge> &Edges);
 
-    void buildLocalVFG(DyckAliasAnalysis *DAA, CFG *DMRA, Function *F) const;
+    static void forEachCallee(DyckCallGraph *, Function &, const std::function<void(Call *, Function *)> &);
 
-    void buildLocalVFG(Function &);
+    static bool isZeroGEP(GetElementPtrInst *);
 };
 
 #endif //DyckAA_DYCKVFG_H
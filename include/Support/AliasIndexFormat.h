@@ -0,0 +1,77 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUPPORT_ALIASINDEXFORMAT_H
+#define SUPPORT_ALIASINDEXFORMAT_H
+
+#include <cstdint>
+
+/// The layout of an alias index file, which is written by canary -dump-alias-index and
+/// read by canary-query via mmap. It does not depend on LLVM.
+///
+/// Values are named by the keys of ValueKey, whose instruction ordinals count the module after
+/// canary's preparing transforms, not the input module. See ValueKey.
+///
+/// The file starts with an AliasIndexHeader, followed by the sections it locates.
+/// All sections are arrays of 32-bit words, except the string pool.
+///   Keys        - AliasIndexKey[NumKeys], sorted by the key strings, for binary search
+///   Strings     - the key strings, not null-terminated
+///   ClassBegins - uint32_t[NumClasses + 1], members of class K are Members[ClassBegins[K], ClassBegins[K + 1])
+///   Members     - uint32_t[NumMembers], indices of keys
+///   MayNull     - uint32_t[(NumClasses + 31) / 32], bit K is set if class K may be null
+///   CallSites   - AliasIndexCallSite[NumCallSites], sorted by the key index of the call instruction
+///   Callees     - uint32_t[NumCallees], indices of the keys of callee functions
+namespace AliasIndex {
+    static const char Magic[8] = {'C', 'A', 'N', 'A', 'R', 'Y', 'A', 'I'};
+    static const uint32_t Version = 1;
+
+    /// the key names an operand (func:N:K), and is not in the member arrays
+    static const uint32_t OperandKey = 1;
+}
+
+struct AliasIndexHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t NumKeys;
+    uint32_t NumClasses;
+    uint32_t NumMembers;
+    uint32_t NumCallSites;
+    uint32_t NumCallees;
+    uint64_t KeysOffset;
+    uint64_t StringsOffset;
+    uint64_t ClassBeginsOffset;
+    uint64_t MembersOffset;
+    uint64_t MayNullOffset;
+    uint64_t CallSitesOffset;
+    uint64_t CalleesOffset;
+};
+
+struct AliasIndexKey {
+    uint32_t StringOffset;
+    uint32_t StringLength;
+    uint32_t ClassID;
+    uint32_t Flags;
+};
+
+struct AliasIndexCallSite {
+    uint32_t Key;
+    uint32_t CalleesBegin;
+    uint32_t CalleesEnd;
+};
+
+#endif // SUPPORT_ALIASINDEXFORMAT_H
@@ -46,6 +46,9 @@ public:
     /// Wait until no tasks remain
     void wait();
 
+    /// the number of worker threads, 0 means tasks run in the calling thread when enqueued
+    unsigned numWorkers() const { return Workers.size(); }
+
     /// each thread is allowed to deaclare a thread local
     /// if you want to decalre more, you can pack them into a struct
     /// you need manually call deinitThreadLocal to delete the
@@ -109,6 +112,14 @@ public:
 
 public:
     static ThreadPool *get();
+
+    /// hooks to carry a context of the enqueuing thread into its tasks, e.g., the client of alias queries.
+    /// CaptureHook returns the context of the current thread, and SwitchHook sets the context of the
+    /// current thread and returns the previous one
+    /// @{
+    static void *(*CaptureHook)();
+    static void *(*SwitchHook)(void *);
+    /// @}
 };
 
 
@@ -132,7 +143,12 @@ auto ThreadPool::enqueue(F &&Func, Args &&... Arguments) -> std::future<typename
         if (IsStop)
             llvm_unreachable("enqueue on stopped ThreadPool");
 
-        TaskQueue.emplace([Task]() { (*Task)(); });
+        void *Context = CaptureHook ? CaptureHook() : nullptr;
+        TaskQueue.emplace([Task, Context]() {
+            void *Prev = SwitchHook ? SwitchHook(Context) : nullptr;
+            (*Task)();
+            if (SwitchHook) SwitchHook(Prev);
+        });
     }
     Condition.notify_one();
     return Res;
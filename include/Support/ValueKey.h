@@ -0,0 +1,58 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUPPORT_VALUEKEY_H
+#define SUPPORT_VALUEKEY_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Module.h>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+/// Stable textual keys of values in a module, used by clients outside the process.
+///   @name    - a global variable or a function
+///   func:aK  - the K-th argument of func
+///   func:N   - the N-th instruction of func
+///   func:N:K - the K-th operand of the N-th instruction of func
+///
+/// The keys are those of the module canary analyzes, i.e., the input after canary's own preparing
+/// transforms (mem2reg, sccp, loop-simplify, lowering constant expressions, ...), not the input itself.
+/// The ordinals of instructions thus differ from those in the input. "canary <input> -S -o <file>"
+/// without the transform options writes the module that the keys refer to.
+class ValueKey {
+private:
+    Module &M;
+    DenseMap<const Instruction *, unsigned> Ordinals;
+    DenseMap<const Function *, std::vector<Instruction *>> Instructions;
+
+public:
+    explicit ValueKey(Module &M);
+
+    /// return the key of \p V, or an empty string if \p V has no key, e.g., a non-global constant
+    std::string get(const Value *V) const;
+
+    /// return the value of \p Key, or nullptr if \p Key is malformed or not found.
+    /// for an operand key, \p Context is set to the instruction using the operand, otherwise,
+    /// it is set to the value itself if the value is an instruction, or nullptr
+    Value *resolve(StringRef Key, Instruction **Context = nullptr) const;
+};
+
+#endif // SUPPORT_VALUEKEY_H
@@ -0,0 +1,47 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSFORM_ALIASSCOPEMETADATA_H
+#define TRANSFORM_ALIASSCOPEMETADATA_H
+
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+
+using namespace llvm;
+
+/// Attach !alias.scope and !noalias metadata to the loads and stores of each function,
+/// so that LLVM's scoped-noalias analysis separates the accesses that dyck-aa proves disjoint.
+/// Each offset component of the accessed pointers gets a scope in a per-function domain.
+/// At most MaxScopes components with the most accesses get scopes in a function.
+class AliasScopeMetadata : public ModulePass {
+private:
+    unsigned MaxScopes;
+
+public:
+    static char ID;
+
+    explicit AliasScopeMetadata(unsigned MaxScopes = 64) : ModulePass(ID), MaxScopes(MaxScopes) {}
+
+    ~AliasScopeMetadata() override = default;
+
+    void getAnalysisUsage(AnalysisUsage &) const override;
+
+    bool runOnModule(Module &) override;
+};
+
+#endif //TRANSFORM_ALIASSCOPEMETADATA_H
@@ -0,0 +1,82 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSFORM_FUNCTIONATTRINFERENCE_H
+#define TRANSFORM_FUNCTIONATTRINFERENCE_H
+
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+#include <map>
+
+#include "DyckAA/DyckCallGraph.h"
+
+using namespace llvm;
+
+/// Infer readnone, readonly, argmemonly, nocapture and noalias-return attributes bottom-up
+/// over the sccs of the dyck call graph, so that pointer calls resolved by dyck-aa are seen through.
+/// Attributes are only added or strengthened, never weakened.
+class FunctionAttrInference : public ModulePass {
+public:
+    /// memory effects of a function, ignoring its own stack objects
+    enum MemoryEffect : unsigned {
+        ME_None = 0,
+        ME_ReadArg = 1,
+        ME_WriteArg = 2,
+        ME_ReadOther = 4,
+        ME_WriteOther = 8,
+        ME_All = ME_ReadArg | ME_WriteArg | ME_ReadOther | ME_WriteOther,
+    };
+
+private:
+    DyckCallGraph *DyckCG = nullptr;
+
+    std::map<Function *, unsigned> Effects;
+
+public:
+    static char ID;
+
+    FunctionAttrInference() : ModulePass(ID) {}
+
+    ~FunctionAttrInference() override = default;
+
+    void getAnalysisUsage(AnalysisUsage &) const override;
+
+    bool runOnModule(Module &) override;
+
+private:
+    /// compute the memory effects of the functions in an scc to a fixed point
+    void inferMemoryEffects(ArrayRef<DyckCallGraphNode *> SCC);
+
+    unsigned getMemoryEffects(Function *F);
+
+    /// the memory effects of a call, with the accesses to arguments mapped to the caller
+    unsigned getCallEffects(CallBase *CB, Function *Caller);
+
+    /// the memory effects of a callee, by its inferred effects if it is analyzed, or by its attributes
+    unsigned getCalleeEffects(CallBase *CB, Function *Callee);
+
+    /// the functions \p CB may call, false if some callee is unknown
+    bool getCallees(CallBase *CB, Function *Caller, SmallVectorImpl<Function *> &Callees) const;
+
+    bool mayCapture(Value *V, Function *F, bool ReturnCaptures) const;
+
+    bool isMallocLike(Function *F) const;
+};
+
+#endif //TRANSFORM_FUNCTIONATTRINFERENCE_H
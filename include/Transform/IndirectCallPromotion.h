@@ -0,0 +1,45 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRANSFORM_INDIRECTCALLPROMOTION_H
+#define TRANSFORM_INDIRECTCALLPROMOTION_H
+
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+
+using namespace llvm;
+
+/// Promote the pointer calls that have at most MaxTargets callees resolved by dyck-aa
+/// to guarded direct calls, keeping the indirect call as the fallback
+class IndirectCallPromotion : public ModulePass {
+private:
+    unsigned MaxTargets;
+
+public:
+    static char ID;
+
+    explicit IndirectCallPromotion(unsigned MaxTargets = 2) : ModulePass(ID), MaxTargets(MaxTargets) {}
+
+    ~IndirectCallPromotion() override = default;
+
+    void getAnalysisUsage(AnalysisUsage &) const override;
+
+    bool runOnModule(Module &) override;
+};
+
+#endif //TRANSFORM_INDIRECTCALLPROMOTION_H
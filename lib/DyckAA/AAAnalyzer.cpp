@@ -19,7 +19,9 @@
 #include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/IR/InstIterator.h>
 #include "AAAnalyzer.h"
+#include "Support/API.h"
 #include "Support/RecursiveTimer.h"
+#include "Support/ThreadPool.h"
 
 static cl::opt<unsigned> FunctionTypeCheckLevel("function-type-check-level", cl::init(4), cl::Hidden,
                                                 cl::desc("The level of checking the compatability of function types"
@@ -38,12 +40,25 @@ static cl::opt<bool> PrintUnknownPointerCall("print-unknown-ptr-call", cl::init(
 static cl::opt<unsigned> NumInterIteration("dyckaa-inter-iteration", cl::init(UINT_MAX), cl::Hidden,
                                            cl::desc("The max # iterators for fixed-point inter-proc computation."));
 
+static cl::opt<unsigned> TimeBudget("dyckaa-time-budget", cl::init(0), cl::Hidden,
+                                    cl::desc("The wall-clock budget (in seconds) for the inter-proc computation, "
+                                             "0 means no budget."));
+
+static cl::opt<bool> DetectAllocWrapper("dyckaa-alloc-wrapper", cl::init(true), cl::Hidden,
+                                        cl::desc("Treat each call to an allocation wrapper as a fresh allocation."));
+
+static cl::list<std::string> SliceSeeds("dyckaa-slice", cl::CommaSeparated, cl::Hidden,
+                                        cl::desc("Only analyze the part of the module that may affect "
+                                                 "the given functions or global variables."));
+
 AAAnalyzer::AAAnalyzer(Module *M, DyckGraph *DG, DyckCallGraph *CG) {
     Mod = M;
     CFLGraph = DG;
     DyckCG = CG;
     DL = &M->getDataLayout();
     initFunctionGroups();
+    if (DetectAllocWrapper) initAllocWrappers();
+    if (!SliceSeeds.empty()) initSlice();
 }
 
 AAAnalyzer::~AAAnalyzer() {
@@ -60,6 +75,7 @@ void AAAnalyzer::intraProcedureAnalysis() {
             IntrinsicsNum++;
             continue;
         }
+        if (!Slice.empty() && !Slice.count(&F)) continue;
         DyckCallGraphNode *DF = DyckCG->getOrInsertFunction(&F);
         for (auto &I: instructions(F)) {
             InstNum++;
@@ -73,53 +89,65 @@ void AAAnalyzer::intraProcedureAnalysis() {
 void AAAnalyzer::interProcedureAnalysis() {
     RecursiveTimer IntraAA("Running inter-procedural analysis");
 
+    std::chrono::steady_clock::time_point Deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(TimeBudget.getValue());
+    auto *DeadlinePtr = TimeBudget.getValue() ? &Deadline : nullptr;
+    auto TimeOut = [DeadlinePtr]() { return DeadlinePtr && std::chrono::steady_clock::now() >= *DeadlinePtr; };
+
+    const char *BudgetHit = nullptr;
+    bool DirectCallsHandled = false;
     unsigned IterationCounter = 0;
     while (true) {
-        if (IterationCounter++ >= NumInterIteration.getValue())
+        if (IterationCounter >= NumInterIteration.getValue()) {
+            BudgetHit = "iteration";
+            break;
+        }
+        if (TimeOut()) {
+            BudgetHit = "time";
             break;
+        }
+        IterationCounter++;
         RecursiveTimer IterationTimer("Iteration " + std::to_string(IterationCounter));
 
         bool Finished = true;
-        CFLGraph->qirunAlgorithm();
-
-        if (IterationCounter == 1) { // direct calls
-            RecursiveTimer DirectCallTimer("Handling direct calls");
-            auto CGNodeIt = DyckCG->nodes_begin();
-            while (CGNodeIt != DyckCG->nodes_end()) {
-                DyckCallGraphNode *CGNode = *CGNodeIt;
-                auto CIt = CGNode->common_call_begin();
-                while (CIt != CGNode->common_call_end()) {
-                    Finished = false;
-                    CommonCall *CC = *CIt;
-                    Function *CV = CC->getCalledFunction();
-                    assert(CV && "Error: it is not a function in common calls!");
-                    handleCommonFunctionCall(CC, CGNode, DyckCG->getOrInsertFunction(CV));
-                    ++CIt;
-                }
-                ++CGNodeIt;
-            }
+        CFLGraph->qirunAlgorithm(DeadlinePtr);
+        if (TimeOut()) {
+            BudgetHit = "time";
+            break;
+        }
+
+        if (!DirectCallsHandled) {
+            handleDirectFunctionCalls();
+            DirectCallsHandled = true;
+            Finished = false;
         }
 
         { // indirect call
             RecursiveTimer DirectCallTimer("Handling indirect calls");
-            int NumProcessedFunctions = 0;
-            auto DFIt = DyckCG->begin();
-            while (DFIt != DyckCG->end()) {
-                DyckCallGraphNode *DF = DFIt->second;
-
-                if (handlePointerFunctionCalls(DF, ++NumProcessedFunctions)) {
-                    Finished = false;
-                }
-
-                ++DFIt;
+            if (handlePointerFunctionCalls()) {
+                Finished = false;
             }
         }
 
         if (Finished) break;
     }
 
-    // finalize the call graph
+    if (BudgetHit) {
+        // the budget is exhausted, the remaining work is soundly over-approximated:
+        // each pointer call may call all its type-compatible address-taken functions
+        RecursiveTimer BudgetTimer("Over-approximating unresolved calls");
+        if (!DirectCallsHandled) handleDirectFunctionCalls();
+        unsigned long NumSkipped = overApproximatePointerFunctionCalls();
+        outs() << "The " << BudgetHit << " budget of the inter-procedural analysis is hit after "
+               << IterationCounter << " iteration(s): " << NumSkipped
+               << " callee(s) of pointer calls are added without alias checking.\n";
+    }
+    // solving the graph to the fixed point is necessary for soundness, so we do not bound it
+    CFLGraph->qirunAlgorithm();
+
+    // finalize the call graph, functions outside the slice have no calls and get no nodes
     for (auto &F: *Mod) {
+        if (!Slice.empty() && !Slice.count(&F)) continue;
         auto *FN = DyckCG->getOrInsertFunction(&F);
         for (auto It = FN->common_call_begin(), E = FN->common_call_end(); It != E; ++It) {
             auto *CC = *It;
@@ -137,6 +165,8 @@ void AAAnalyzer::interProcedureAnalysis() {
         }
     }
 
+    DyckCG->computeSCCs();
+
     if (PrintUnknownPointerCall) printNoAliasedPointerCalls();
 }
 
@@ -144,9 +174,9 @@ void AAAnalyzer::printNoAliasedPointerCalls() {
     unsigned Size = 0;
 
     outs() << ">>>>>>>>>> Pointer calls that do not find any aliased function\n";
-    auto DFIt = DyckCG->begin();
-    while (DFIt != DyckCG->end()) {
-        DyckCallGraphNode *DF = DFIt->second;
+    auto DFIt = DyckCG->nodes_begin();
+    while (DFIt != DyckCG->nodes_end()) {
+        DyckCallGraphNode *DF = *DFIt;
         auto PCIt = DF->pointer_call_begin();
         while (PCIt != DF->pointer_call_end()) {
             PointerCall *PC = *PCIt;
@@ -304,6 +334,163 @@ void AAAnalyzer::combineFunctionGroups(FunctionType *FTyX, FunctionType *FTyY) {
     Y->CompatibleFuncs.insert(X->CompatibleFuncs.begin(), X->CompatibleFuncs.end());
 }
 
+void AAAnalyzer::initAllocWrappers() {
+    // wrappers may call other wrappers, e.g., xmalloc -> pool_alloc -> malloc,
+    // so we iterate until no new wrapper is found
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        for (auto &F: *Mod) {
+            if (AllocWrappers.count(&F) || !isAllocWrapper(&F)) continue;
+            AllocWrappers.insert(&F);
+            Changed = true;
+        }
+    }
+    DEBUG_WITH_TYPE("dyckaa-stats", errs() << "# Allocation wrappers: " << AllocWrappers.size() << "\n");
+}
+
+bool AAAnalyzer::isAllocWrapper(Function *F) const {
+    if (F->empty() || F->isIntrinsic() || !F->getReturnType()->isPointerTy()) return false;
+
+    // collect the values the returned pointers flow from, through casts, phis and selects;
+    // each of them must finally come from a call to a heap allocation function or to a known wrapper
+    std::set<Value *> FlowValues;
+    std::vector<Value *> WorkList;
+    for (auto &B: *F) {
+        if (auto *Ret = dyn_cast<ReturnInst>(B.getTerminator())) {
+            if (!Ret->getReturnValue()) return false;
+            WorkList.push_back(Ret->getReturnValue());
+        }
+    }
+    if (WorkList.empty()) return false;
+    while (!WorkList.empty()) {
+        Value *V = WorkList.back();
+        WorkList.pop_back();
+        if (!FlowValues.insert(V).second) continue;
+
+        if (isa<BitCastInst>(V) || isa<AddrSpaceCastInst>(V)) {
+            WorkList.push_back(((CastInst *) V)->getOperand(0));
+        } else if (auto *Phi = dyn_cast<PHINode>(V)) {
+            for (unsigned K = 0; K < Phi->getNumIncomingValues(); ++K) WorkList.push_back(Phi->getIncomingValue(K));
+        } else if (auto *Select = dyn_cast<SelectInst>(V)) {
+            WorkList.push_back(Select->getTrueValue());
+            WorkList.push_back(Select->getFalseValue());
+        } else if (auto *CI = dyn_cast<CallInst>(V)) {
+            Function *Callee = CI->getCalledFunction();
+            if (!Callee) return false;
+            if (!AllocWrappers.count(Callee) && !API::HeapAllocFunctions.count(Callee->getName().str())) return false;
+        } else {
+            return false;
+        }
+    }
+
+    // the allocated pointer must not escape except by being returned,
+    // otherwise the callers' copies would miss what the wrapper does with it
+    for (auto *V: FlowValues) {
+        for (auto *U: V->users()) {
+            if (isa<ReturnInst>(U) || isa<ICmpInst>(U)) continue;
+            if (FlowValues.count(U)) continue;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// collect the global values used by constant \p C, and the instructions and global values
+/// that use \p C, looking through other constants
+static void collectConstantReferences(Constant *C, std::set<GlobalValue *> &Globals,
+                                      std::set<Instruction *> *Insts) {
+    std::set<Constant *> Visited;
+    std::vector<Constant *> WorkList;
+    WorkList.push_back(C);
+    while (!WorkList.empty()) {
+        Constant *Top = WorkList.back();
+        WorkList.pop_back();
+        if (!Visited.insert(Top).second) continue;
+        if (auto *GV = dyn_cast<GlobalValue>(Top)) {
+            Globals.insert(GV);
+            if (Top != C || !Insts) continue;
+        }
+        if (!Insts) {
+            // operands: from the initializer to the globals it references
+            for (unsigned K = 0; K < Top->getNumOperands(); ++K)
+                if (auto *Op = dyn_cast<Constant>(Top->getOperand(K))) WorkList.push_back(Op);
+            continue;
+        }
+        // users: from a global value to the instructions and globals referencing it
+        for (auto *U: Top->users()) {
+            if (auto *I = dyn_cast<Instruction>(U)) Insts->insert(I);
+            else if (auto *UC = dyn_cast<Constant>(U)) WorkList.push_back(UC);
+        }
+    }
+}
+
+void AAAnalyzer::initSlice() {
+    RecursiveTimer SliceTimer("Slicing the module");
+
+    std::set<GlobalValue *> Visited;
+    std::vector<GlobalValue *> WorkList;
+    auto AddGlobal = [&Visited, &WorkList](GlobalValue *GV) {
+        if (Visited.insert(GV).second) WorkList.push_back(GV);
+    };
+    for (auto &Name: SliceSeeds) {
+        if (auto *GV = Mod->getNamedValue(Name)) AddGlobal(GV);
+        else errs() << "WARNING: cannot find \"" << Name << "\" for slicing, ignored.\n";
+    }
+    if (Visited.empty()) return;
+
+    // functions with indirect calls and functions whose address is taken may call each other
+    std::vector<Function *> IndirectCallers, AddressTaken;
+    for (auto &F: *Mod) {
+        if (F.isIntrinsic()) continue;
+        if (F.hasAddressTaken()) AddressTaken.push_back(&F);
+        for (auto &I: instructions(F)) {
+            auto *CI = dyn_cast<CallBase>(&I);
+            if (CI && !CI->getCalledFunction() && !CI->isInlineAsm()) {
+                IndirectCallers.push_back(&F);
+                break;
+            }
+        }
+    }
+    bool IndirectCallersAdded = false, AddressTakenAdded = false;
+
+    // a sound closure: callers, callees, and all functions touching the same globals.
+    // escaping heap objects can only be passed around through parameters, returns and globals,
+    // so they are covered by the closure as well
+    while (!WorkList.empty()) {
+        GlobalValue *GV = WorkList.back();
+        WorkList.pop_back();
+
+        std::set<GlobalValue *> Globals;
+        std::set<Instruction *> Users;
+        collectConstantReferences(GV, Globals, &Users);
+        for (auto *I: Users) AddGlobal(I->getFunction());
+        if (auto *GVar = dyn_cast<GlobalVariable>(GV)) {
+            if (GVar->hasInitializer()) collectConstantReferences(GVar->getInitializer(), Globals, nullptr);
+        } else if (auto *GA = dyn_cast<GlobalAlias>(GV)) {
+            collectConstantReferences(GA->getAliasee(), Globals, nullptr);
+        } else if (auto *F = dyn_cast<Function>(GV)) {
+            Slice.insert(F);
+            if (F->hasAddressTaken() && !IndirectCallersAdded) {
+                IndirectCallersAdded = true;
+                for (auto *Caller: IndirectCallers) AddGlobal(Caller);
+            }
+            for (auto &I: instructions(F)) {
+                for (unsigned K = 0; K < I.getNumOperands(); ++K)
+                    if (auto *C = dyn_cast<Constant>(I.getOperand(K))) collectConstantReferences(C, Globals, nullptr);
+                auto *CI = dyn_cast<CallBase>(&I);
+                if (CI && !CI->getCalledFunction() && !CI->isInlineAsm() && !AddressTakenAdded) {
+                    AddressTakenAdded = true;
+                    for (auto *Callee: AddressTaken) AddGlobal(Callee);
+                }
+            }
+        }
+        for (auto *G: Globals) AddGlobal(G);
+    }
+
+    outs() << "The slice includes " << Slice.size() << " of " << Mod->size() << " functions.\n";
+}
+
 DyckGraphNode *AAAnalyzer::addField(DyckGraphNode *Val, long FieldIndex, DyckGraphNode *Field) {
     if (!Field) {
         auto *ValRepSet = Val->getOutVertices((void *) (CFLGraph->getOrInsertIndexEdgeLabel(FieldIndex)));
@@ -399,6 +586,17 @@ DyckGraphNode *AAAnalyzer::handleGEP(GEPOperator *GEP) {
     return Current;
 }
 
+/// return false if \p C is a constant without any pointer, e.g., an integer table,
+/// so that it cannot affect the alias relations
+static bool mayCarryPointer(Constant *C) {
+    if (isa<ConstantPointerNull>(C)) return true; // for null checking
+    if (isa<ConstantData>(C)) return false;
+    if (!isa<ConstantAggregate>(C)) return true; // global values, constant expressions, etc.
+    for (unsigned K = 0; K < C->getNumOperands(); K++)
+        if (mayCarryPointer(cast<Constant>(C->getOperand(K)))) return true;
+    return false;
+}
+
 DyckGraphNode *AAAnalyzer::wrapValue(Value *V) {
     // if the vertex of v exists, return it, otherwise create one
     std::pair<DyckGraphNode *, bool> RetPair = CFLGraph->retrieveDyckVertex(V);
@@ -476,16 +674,27 @@ DyckGraphNode *AAAnalyzer::wrapValue(Value *V) {
                 wrapValue(((ConstantExpr *) V)->getOperand(K));
             }
         }
-    } else if (isa<ConstantStruct>(V) || isa<ConstantArray>(V)) {
+    } else if (isa<ConstantStruct>(V)) {
         auto *Agg = (Constant *) V;
         unsigned NumElmt = Agg->getNumOperands();
         for (unsigned K = 0; K < NumElmt; K++) {
-            Value *ElmtK = Agg->getOperand(K);
-
-            std::vector<unsigned> Indices;
-            Indices.push_back(K);
-            ArrayRef<unsigned> indicesRef(Indices);
-            this->handleExtractInsertValueInst(V, Agg->getType(), indicesRef, ElmtK);
+            auto *ElmtK = cast<Constant>(Agg->getOperand(K));
+            if (!mayCarryPointer(ElmtK)) continue;
+            DyckGraphNode *ElmtNode = wrapValue(ElmtK);
+            VDV = wrapValue(V);
+            addField(VDV, K, ElmtNode);
+        }
+        VDV = wrapValue(V);
+    } else if (isa<ConstantArray>(V)) {
+        // elements of an array are summarized by the array itself, and large tables usually
+        // repeat the same element, so each distinct element is handled once
+        auto *Agg = (Constant *) V;
+        SmallPtrSet<Constant *, 16> Handled;
+        for (unsigned K = 0; K < Agg->getNumOperands(); K++) {
+            auto *ElmtK = cast<Constant>(Agg->getOperand(K));
+            if (!Handled.insert(ElmtK).second || !mayCarryPointer(ElmtK)) continue;
+            DyckGraphNode *ElmtNode = wrapValue(ElmtK);
+            VDV = makeAlias(wrapValue(V), ElmtNode);
         }
         VDV = wrapValue(V);
     } else if (isa<ConstantVector>(V)) {
@@ -793,6 +1002,7 @@ void AAAnalyzer::handleInst(Instruction *Inst, DyckCallGraphNode *Parent) {
         case Instruction::IntToPtr: {
             Value *CastOperand = Inst->getOperand(0);
             makeAlias(wrapValue(Inst), wrapValue(CastOperand));
+            if (Inst->getOpcode() == Instruction::IntToPtr) OpaqueValues.push_back(Inst);
 
             //  function pointer cast
             Type *OrigTy = CastOperand->getType();
@@ -877,7 +1087,12 @@ void AAAnalyzer::handleInst(Instruction *Inst, DyckCallGraphNode *Parent) {
             break;
         case Instruction::ICmp:
         case Instruction::FCmp:
+            break;
         default:
+            // the operands of integer arithmetic are not unified, so a pointer computed from
+            // the result may point to anything
+            if (isa<BinaryOperator>(Inst) && Inst->getType()->isIntOrIntVectorTy())
+                OpaqueValues.push_back(Inst);
             break;
     }
 
@@ -927,7 +1142,7 @@ void AAAnalyzer::handleInvokeCallInst(Instruction *Ret, Value *CV, std::vector<V
             handleInstrinsic((Instruction *) Ret);
         } else {
             this->handleLibInvokeCallInst(Ret, (Function *) CV, Args, Parent);
-            Parent->addCommonCall(new CommonCall(Ret, (Function *) CV, Args));
+            Parent->addCommonCall(DyckCG->createCommonCall(Ret, (Function *) CV, Args));
         }
     } else {
         wrapValue(CV);
@@ -939,9 +1154,9 @@ void AAAnalyzer::handleInvokeCallInst(Instruction *Ret, Value *CV, std::vector<V
 
             if (isa<Function>(CVCopy)) {
                 this->handleLibInvokeCallInst(Ret, (Function *) CVCopy, Args, Parent);
-                Parent->addCommonCall(new CommonCall(Ret, (Function *) CVCopy, Args));
+                Parent->addCommonCall(DyckCG->createCommonCall(Ret, (Function *) CVCopy, Args));
             } else {
-                auto *PCall = new PointerCall(Ret, CV, Args);
+                auto *PCall = DyckCG->createPointerCall(Ret, CV, Args);
                 Parent->addPointerCall(PCall);
             }
         } else if (isa<GlobalAlias>(CV)) {
@@ -952,13 +1167,13 @@ void AAAnalyzer::handleInvokeCallInst(Instruction *Ret, Value *CV, std::vector<V
 
             if (isa<Function>(CVCopy)) {
                 this->handleLibInvokeCallInst(Ret, (Function *) CVCopy, Args, Parent);
-                Parent->addCommonCall(new CommonCall(Ret, (Function *) CVCopy, Args));
+                Parent->addCommonCall(DyckCG->createCommonCall(Ret, (Function *) CVCopy, Args));
             } else {
-                auto *PCall = new PointerCall(Ret, CV, Args);
+                auto *PCall = DyckCG->createPointerCall(Ret, CV, Args);
                 Parent->addPointerCall(PCall);
             }
         } else {
-            auto *PCall = new PointerCall(Ret, CV, Args);
+            auto *PCall = DyckCG->createPointerCall(Ret, CV, Args);
             Parent->addPointerCall(PCall);
         }
     }
@@ -968,7 +1183,11 @@ void AAAnalyzer::handleCommonFunctionCall(Call *C, DyckCallGraphNode *Caller, Dy
     // for better precise, if callee is an empty function, we do not match the args and parameters.
     if (Callee->getLLVMFunction()->empty()) return;
 
-    if (auto *CallInstruction = dyn_cast_or_null<CallInst>(C->getInstruction())) {
+    // the return value of an allocation wrapper is a fresh object at each call site,
+    // so we do not merge the returns of all its callers
+    bool FreshReturn = AllocWrappers.count(Callee->getLLVMFunction());
+    auto *CallInstruction = dyn_cast_or_null<CallInst>(C->getInstruction());
+    if (CallInstruction && !FreshReturn) {
         //return<->call
         Type *CalledValueTy = CallInstruction->getCalledOperand()->getType();
         assert(CalledValueTy->isPointerTy() && "A called value is not a pointer type!");
@@ -1034,71 +1253,101 @@ void AAAnalyzer::handleCommonFunctionCall(Call *C, DyckCallGraphNode *Caller, Dy
     }
 }
 
-bool AAAnalyzer::handlePointerFunctionCalls(DyckCallGraphNode *Caller, int Counter) {
-    bool Ret = false;
-
-    auto PCIt = Caller->pointer_call_begin();
-
-    // print in console
-    unsigned PCTotal = Caller->pointer_call_size();
-    unsigned PCCount = 0;
-//	if (PTCALL_TOTAL == 0)
-//		outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... 100%, 100%. Done!\r";
-
-    while (PCIt != Caller->pointer_call_end()) {
-        // print in console
-        unsigned Percentage = ((++PCCount) * 100 / PCTotal);
-//		outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << percentage << "%, \r";
-
-        PointerCall *PCall = *PCIt;
-        auto *PCalledVal = PCall->getCalledValue();
-        Type *FTy = PCalledVal->getType()->getPointerElementType();
-        assert(FTy->isFunctionTy() && "Error in AAAnalyzer::handlePointerFunctionCalls!");
-
-        // handle each unhandled, possible function
-        std::set<Value *> EquivAndTypeCompSet;
-        auto *EquivSet = (const std::set<Value *> *) CFLGraph->retrieveDyckVertex(PCalledVal).first->getEquivalentSet();
-        std::set<Function *> *Cands = this->getCompatibleFunctions((FunctionType *) FTy);
-        set_intersection(Cands->begin(), Cands->end(), EquivSet->begin(), EquivSet->end(),
-                         inserter(EquivAndTypeCompSet, EquivAndTypeCompSet.begin()));
-
-        std::set<Value *> UnhandledFunction;
-        set_difference(EquivAndTypeCompSet.begin(), EquivAndTypeCompSet.end(), PCall->begin(), PCall->end(),
-                       inserter(UnhandledFunction, UnhandledFunction.begin()));
-
-        // print in console
-        unsigned CandTotal = UnhandledFunction.size();
-        unsigned CandCount = 0;
-        if (CandTotal == 0) {
-//			outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << "100%, 100%. Done!\r";
-            PCIt++;
-            continue;
+void AAAnalyzer::handleDirectFunctionCalls() {
+    RecursiveTimer DirectCallTimer("Handling direct calls");
+    auto CGNodeIt = DyckCG->nodes_begin();
+    while (CGNodeIt != DyckCG->nodes_end()) {
+        DyckCallGraphNode *CGNode = *CGNodeIt;
+        auto CIt = CGNode->common_call_begin();
+        while (CIt != CGNode->common_call_end()) {
+            CommonCall *CC = *CIt;
+            Function *CV = CC->getCalledFunction();
+            assert(CV && "Error: it is not a function in common calls!");
+            handleCommonFunctionCall(CC, CGNode, DyckCG->getOrInsertFunction(CV));
+            ++CIt;
         }
+        ++CGNodeIt;
+    }
+}
 
-        auto PFIt = UnhandledFunction.begin();
-        while (PFIt != UnhandledFunction.end()) {
-            auto *MayAliasedFunctioin = (Function *) (*PFIt);
-            // print in console
-//            unsigned Rate = ((100 * (++CandCount)) / CandTotal);
-//            if (Percentage == 100 && Rate == 100) {
-//				outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << "100%, 100%. Done!\r";
-//            } else {
-//				outs() << "Handling indirect calls in Function #" << FUNCTION_COUNT << "... " << percentage << "%, " << RATE << "%         \r";
-//            }
+unsigned long AAAnalyzer::overApproximatePointerFunctionCalls() {
+    unsigned long NumAdded = 0;
+    for (auto CGNodeIt = DyckCG->nodes_begin(); CGNodeIt != DyckCG->nodes_end(); ++CGNodeIt) {
+        DyckCallGraphNode *Caller = *CGNodeIt;
+        for (auto PCIt = Caller->pointer_call_begin(); PCIt != Caller->pointer_call_end(); ++PCIt) {
+            PointerCall *PCall = *PCIt;
+            Type *FTy = PCall->getCalledValue()->getType()->getPointerElementType();
+            assert(FTy->isFunctionTy() && "Error in AAAnalyzer::overApproximatePointerFunctionCalls!");
+            std::set<Function *> *Cands = getCompatibleFunctions((FunctionType *) FTy);
+
+            std::vector<Function *> Unhandled;
+            for (auto *F: *Cands) if (!PCall->mayCall(F)) Unhandled.push_back(F);
+            for (auto *F: Unhandled) {
+                PCall->addMayAliasedFunction(F);
+                makeAlias(wrapValue(F), wrapValue(PCall->getCalledValue()));
+                handleCommonFunctionCall(PCall, Caller, DyckCG->getOrInsertFunction(F));
+                handleLibInvokeCallInst(PCall->getInstruction(), F, &(PCall->getArgs()), Caller);
+            }
+            NumAdded += Unhandled.size();
+        }
+    }
+    return NumAdded;
+}
 
-            if (!Ret) Ret = true;
-            PCall->addMayAliasedFunction(MayAliasedFunctioin);
-            handleCommonFunctionCall(PCall, Caller, DyckCG->getOrInsertFunction(MayAliasedFunctioin));
-            handleLibInvokeCallInst(PCall->getInstruction(), MayAliasedFunctioin, &(PCall->getArgs()), Caller);
-            PFIt++;
+bool AAAnalyzer::handlePointerFunctionCalls() {
+    // phase 1 (serial): collect pointer calls and their candidate functions.
+    // getCompatibleFunctions may create new function groups, so it is not safe to call it in parallel.
+    std::vector<PointerCallRecord> PointerCalls;
+    for (auto CGNodeIt = DyckCG->nodes_begin(); CGNodeIt != DyckCG->nodes_end(); ++CGNodeIt) {
+        DyckCallGraphNode *Caller = *CGNodeIt;
+        for (auto PCIt = Caller->pointer_call_begin(); PCIt != Caller->pointer_call_end(); ++PCIt) {
+            PointerCall *PCall = *PCIt;
+            Type *FTy = PCall->getCalledValue()->getType()->getPointerElementType();
+            assert(FTy->isFunctionTy() && "Error in AAAnalyzer::handlePointerFunctionCalls!");
+            PointerCalls.push_back({Caller, PCall, getCompatibleFunctions((FunctionType *) FTy), {}});
         }
+    }
 
-        PCIt++;
+    // phase 2 (parallel): the graph has been solved, so computing new candidates is read-only
+    const unsigned ChunkSize = 64;
+    for (unsigned Begin = 0; Begin < PointerCalls.size(); Begin += ChunkSize) {
+        unsigned End = std::min(Begin + ChunkSize, (unsigned) PointerCalls.size());
+        ThreadPool::get()->enqueue([this, &PointerCalls, Begin, End]() {
+            for (unsigned K = Begin; K < End; ++K) collectUnhandledFunctions(PointerCalls[K]);
+        });
     }
+    ThreadPool::get()->wait();
 
+    // phase 3 (serial): apply the unifications
+    bool Ret = false;
+    for (auto &Record: PointerCalls) {
+        PointerCall *PCall = Record.PCall;
+        for (auto *MayAliasedFunction: Record.UnhandledFunctions) {
+            if (!Ret) Ret = true;
+            PCall->addMayAliasedFunction(MayAliasedFunction);
+            handleCommonFunctionCall(PCall, Record.Caller, DyckCG->getOrInsertFunction(MayAliasedFunction));
+            handleLibInvokeCallInst(PCall->getInstruction(), MayAliasedFunction, &(PCall->getArgs()), Record.Caller);
+        }
+    }
     return Ret;
 }
 
+void AAAnalyzer::collectUnhandledFunctions(PointerCallRecord &Record) const {
+    PointerCall *PCall = Record.PCall;
+    auto *CalledNode = CFLGraph->findDyckVertex(PCall->getCalledValue());
+    assert(CalledNode && "The called value of a pointer call must have been wrapped!");
+
+    // type-compatible functions in the equivalent set of the called value, minus those handled before
+    std::set<Value *> EquivAndTypeCompSet;
+    auto *EquivSet = (const std::set<Value *> *) CalledNode->getEquivalentSet();
+    std::set<Function *> *Cands = Record.Candidates;
+    set_intersection(Cands->begin(), Cands->end(), EquivSet->begin(), EquivSet->end(),
+                     inserter(EquivAndTypeCompSet, EquivAndTypeCompSet.begin()));
+
+    for (auto *F: EquivAndTypeCompSet)
+        if (!PCall->mayCall((Function *) F)) Record.UnhandledFunctions.push_back((Function *) F);
+}
+
 void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vector<Value *> *Args,
                                          DyckCallGraphNode *Parent) {
     // args must be the real arguments, not the parameters.
@@ -1106,6 +1355,7 @@ void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vec
         return;
 
     auto FName = F->getName();
+    bool Modeled = true;
     switch (Args->size()) {
         case 1: {
             if (FName == "strdup" || FName == "__strdup" || FName == "strdupa") {
@@ -1116,6 +1366,8 @@ void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vec
                 DyckGraphNode *ValRep = wrapValue(Ret);
                 // we use label -1 to indicate that it is a key:value pair
                 KeyRep->addTarget(ValRep, CFLGraph->getOrInsertIndexEdgeLabel(-1));
+            } else {
+                Modeled = false;
             }
         }
             break;
@@ -1147,6 +1399,8 @@ void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vec
                 DyckGraphNode *ValRep = wrapValue(Args->at(1));
                 // we use label -1 to indicate that it is a key:value pair
                 KeyRep->addTarget(ValRep, CFLGraph->getOrInsertIndexEdgeLabel(-1));
+            } else {
+                Modeled = false;
             }
         }
             break;
@@ -1168,6 +1422,8 @@ void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vec
             } else if (FName == "strtok_r" || FName == "__strtok_r") {
                 // content alias r/1st
                 this->makeContentAlias(wrapValue(Args->at(0)), wrapValue(Ret));
+            } else {
+                Modeled = false;
             }
         }
             break;
@@ -1176,10 +1432,18 @@ void AAAnalyzer::handleLibInvokeCallInst(Value *Ret, Function *F, const std::vec
                 std::vector<Value *> XArgs;
                 XArgs.push_back(Args->at(3));
                 handleInvokeCallInst(nullptr, Args->at(2), &XArgs, DyckCG->getOrInsertFunction(F));
+            } else {
+                Modeled = false;
             }
         }
             break;
         default:
+            Modeled = false;
             break;
     }
+
+    // the returned pointer of an external function that is not modeled may point to anything,
+    // except that of an allocation function, which is a fresh object
+    if (!Modeled && Ret && Ret->getType()->isPointerTy() && !API::HeapAllocFunctions.count(FName.str()))
+        OpaqueValues.push_back(Ret);
 }
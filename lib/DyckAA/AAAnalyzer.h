@@ -31,6 +31,7 @@
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 #include "DyckAA/DyckCallGraph.h"
 #include "DyckAA/DyckGraph.h"
@@ -43,6 +44,15 @@ typedef struct FunctionTypeNode {
     std::set<Function *> CompatibleFuncs;
 } FunctionTypeNode;
 
+/// A pointer call, its type-compatible candidates, and the candidates
+/// that are found to be newly aliased with the called value in a round
+typedef struct PointerCallRecord {
+    DyckCallGraphNode *Caller;
+    PointerCall *PCall;
+    std::set<Function *> *Candidates;
+    std::vector<Function *> UnhandledFunctions;
+} PointerCallRecord;
+
 class AAAnalyzer {
 private:
     Module *Mod;
@@ -56,6 +66,17 @@ private:
     std::set<FunctionTypeNode *> TyRoots;
     /// @}
 
+    /// Functions whose returned pointer only comes from a heap allocation,
+    /// each call to them is regarded as a fresh allocation site
+    std::set<Function *> AllocWrappers;
+
+    /// If not empty, only the functions in the slice are analyzed
+    std::set<Function *> Slice;
+
+    /// Values the analysis cannot track, e.g., integers that may be cast to pointers,
+    /// and pointers returned by external functions that are not modeled
+    std::vector<Value *> OpaqueValues;
+
 public:
     AAAnalyzer(Module *, DyckGraph *, DyckCallGraph *);
 
@@ -65,6 +86,10 @@ public:
 
     void interProcedureAnalysis();
 
+    const std::vector<Value *> &getOpaqueValues() const { return OpaqueValues; }
+
+    bool isSliced() const { return !Slice.empty(); }
+
 private:
     void printNoAliasedPointerCalls();
 
@@ -83,7 +108,18 @@ private:
 
     void handleLibInvokeCallInst(Value *Ret, Function *F, const std::vector<Value *> *Args, DyckCallGraphNode *Parent);
 
-    bool handlePointerFunctionCalls(DyckCallGraphNode *Caller, int Counter);
+    void handleDirectFunctionCalls();
+
+    /// let each pointer call call all of its type-compatible functions without checking aliases,
+    /// used when the budget is exhausted. return the number of newly added callees
+    unsigned long overApproximatePointerFunctionCalls();
+
+    /// resolve pointer calls in two phases: new callees of each pointer call are
+    /// computed in parallel against the solved graph, then unified serially.
+    /// return true if some new callees are found
+    bool handlePointerFunctionCalls();
+
+    void collectUnhandledFunctions(PointerCallRecord &) const;
 
     void handleCommonFunctionCall(Call *, DyckCallGraphNode *Caller, DyckCallGraphNode *Callee);
 
@@ -100,6 +136,13 @@ private:
 
     void combineFunctionGroups(FunctionType *, FunctionType *);
 
+    void initAllocWrappers();
+
+    bool isAllocWrapper(Function *) const;
+
+    /// compute the functions that may affect the alias relations of the slicing seeds
+    void initSlice();
+
 private:
     /// return the structure's field vertex
     DyckGraphNode *addField(DyckGraphNode *Val, long FieldIndex, DyckGraphNode *Field);
@@ -0,0 +1,142 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "DyckAA/AliasQueryProfiler.h"
+#include "Support/ThreadPool.h"
+
+using namespace llvm;
+
+std::string AliasQueryProfiler::ReportFile;
+
+static cl::opt<std::string, true> ProfileQueries("dyckaa-profile-queries", cl::location(AliasQueryProfiler::ReportFile),
+                                                 cl::value_desc("file"), cl::Hidden,
+                                                 cl::desc("Profile the alias queries and write the report to the "
+                                                          "file at exit, \"-\" for stdout."));
+
+static const char *QueryKindNames[AliasQueryProfiler::QK_NumKinds] = {
+        "mayAlias", "getAliasSet", "mayNull", "mayAliasBatch", "pointsTo"
+};
+
+/// the client the current thread is working for, null if unattributed
+static thread_local void *CurrentClient = nullptr;
+
+/// a task of the thread pool works for the client that enqueues it
+static bool ClientHooksRegistered = []() {
+    ThreadPool::CaptureHook = []() { return CurrentClient; };
+    ThreadPool::SwitchHook = [](void *Client) {
+        std::swap(Client, CurrentClient);
+        return Client;
+    };
+    return true;
+}();
+
+AliasQueryProfiler &AliasQueryProfiler::get() {
+    static AliasQueryProfiler Profiler;
+    return Profiler;
+}
+
+AliasQueryProfiler::AliasQueryProfiler() {
+    Unattributed = getClient("<unattributed>");
+}
+
+AliasQueryProfiler::~AliasQueryProfiler() {
+    printReport();
+}
+
+void AliasQueryProfiler::Histogram::add(unsigned long Value) {
+    unsigned K = Value == 0 ? 0 : Log2_64(Value);
+    Buckets[K < NumBuckets ? K : NumBuckets - 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+AliasQueryProfiler::ClientStats *AliasQueryProfiler::getClient(const std::string &Client) {
+    std::lock_guard<std::mutex> Lock(ClientsMutex);
+    auto &Stats = Clients[Client];
+    if (!Stats) Stats.reset(new ClientStats);
+    return Stats.get();
+}
+
+AliasQueryProfiler::ClientScope::ClientScope(const char *Client) {
+    if (!enabled()) return;
+    Prev = CurrentClient;
+    CurrentClient = get().getClient(Client);
+}
+
+AliasQueryProfiler::ClientScope::~ClientScope() {
+    if (!enabled()) return;
+    CurrentClient = Prev;
+}
+
+void AliasQueryProfiler::record(QueryKind Kind, std::chrono::steady_clock::duration Duration,
+                                unsigned long ClassSize) {
+    unsigned long Nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(Duration).count();
+    auto &KS = Stats[Kind];
+    KS.Count.fetch_add(1, std::memory_order_relaxed);
+    KS.TotalNanos.fetch_add(Nanos, std::memory_order_relaxed);
+    KS.Latency.add(Nanos);
+    KS.ClassSize.add(ClassSize);
+    auto *Client = CurrentClient ? (ClientStats *) CurrentClient : Unattributed;
+    Client->Count[Kind].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void printHistogram(raw_ostream &OS, const char *Title, const std::atomic<unsigned long> *Buckets,
+                           unsigned NumBuckets) {
+    OS << "  " << Title << ":";
+    for (unsigned K = 0; K < NumBuckets; ++K) {
+        unsigned long N = Buckets[K].load();
+        if (N) OS << " [2^" << K << ")=" << N;
+    }
+    OS << "\n";
+}
+
+void AliasQueryProfiler::printReport() {
+    std::error_code EC;
+    raw_fd_ostream OS(ReportFile, EC);
+    if (EC) {
+        errs() << "Cannot write the alias query profile to " << ReportFile << ": " << EC.message() << "\n";
+        return;
+    }
+
+    OS << "===== Alias Query Profile =====\n";
+    for (unsigned K = 0; K < QK_NumKinds; ++K) {
+        auto &KS = Stats[K];
+        unsigned long Count = KS.Count.load();
+        if (!Count) continue;
+        unsigned long Nanos = KS.TotalNanos.load();
+        OS << QueryKindNames[K] << ": " << Count << " call(s), " << Nanos / 1000000 << "ms in total, "
+           << Nanos / Count << "ns on average\n";
+        printHistogram(OS, "latency (ns)", KS.Latency.Buckets, NumBuckets);
+        printHistogram(OS, "class size", KS.ClassSize.Buckets, NumBuckets);
+    }
+
+    OS << "===== Calls per Client =====\n";
+    for (auto &It: Clients) {
+        unsigned long Total = 0;
+        for (unsigned K = 0; K < QK_NumKinds; ++K) Total += It.second->Count[K].load();
+        if (!Total) continue;
+        OS << It.first << ": " << Total << " call(s)";
+        for (unsigned K = 0; K < QK_NumKinds; ++K) {
+            unsigned long N = It.second->Count[K].load();
+            if (N) OS << ", " << QueryKindNames[K] << "=" << N;
+        }
+        OS << "\n";
+    }
+}
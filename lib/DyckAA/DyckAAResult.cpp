@@ -0,0 +1,139 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "DyckAA/DyckAAResult.h"
+
+AnalysisKey DyckAA::Key;
+
+DyckAAResult DyckAA::run(Module &M, ModuleAnalysisManager &) {
+    auto DAA = std::make_shared<DyckAliasAnalysis>();
+    DAA->runOnModule(M);
+    return DyckAAResult(DAA);
+}
+
+DyckAAResult::DyckAAResult(std::shared_ptr<DyckAliasAnalysis> DAAPtr) : AAResultBase(), DAA(std::move(DAAPtr)) {
+    unsigned NumClasses = DAA->getNumAliasClasses();
+
+    ComponentObjects.resize(DAA->getNumOffsetComponents());
+    std::vector<unsigned> Globals;
+    for (unsigned ID = 0; ID < NumClasses; ++ID) {
+        unsigned ObjID = DAA->pointsToClass(ID);
+        if (ObjID != DyckAliasAnalysis::InvalidClassID)
+            ComponentObjects[DAA->getOffsetComponent(ID)].push_back(ObjID);
+        for (auto *V: DAA->getAliasClassMembers(ID)) {
+            if (!isa<GlobalValue>(V)) continue;
+            Globals.push_back(ID);
+            break;
+        }
+    }
+    GlobalReachable.resize(NumClasses);
+    reach(Globals, GlobalReachable, nullptr);
+
+    // constants other than globals are never deleted while they are used
+    unsigned NumHandles = 0;
+    for (unsigned ID = 0; ID < NumClasses; ++ID)
+        for (auto *V: DAA->getAliasClassMembers(ID))
+            if (!isa<Constant>(V) || isa<GlobalValue>(V)) ++NumHandles;
+    Deleted = std::make_unique<DenseSet<const Value *>>();
+    Handles = std::make_unique<std::vector<DeletionHandle>>();
+    Handles->reserve(NumHandles);
+    for (unsigned ID = 0; ID < NumClasses; ++ID)
+        for (auto *V: DAA->getAliasClassMembers(ID))
+            if (!isa<Constant>(V) || isa<GlobalValue>(V)) Handles->emplace_back(V, Deleted.get());
+}
+
+unsigned DyckAAResult::getAliasClassID(const Value *V) const {
+    if (!Deleted->empty() && Deleted->count(V)) return DyckAliasAnalysis::InvalidClassID;
+    return DAA->getAliasClassID(V);
+}
+
+bool DyckAAResult::reach(const std::vector<unsigned> &Sources, BitVector &Reachable,
+                         const std::vector<unsigned> *Targets) const {
+    BitVector TargetSet;
+    if (Targets) {
+        TargetSet.resize(Reachable.size());
+        for (auto ID: *Targets) TargetSet.set(ID);
+    }
+
+    std::vector<unsigned> WorkList;
+    auto Visit = [&](unsigned ID) {
+        if (Reachable.test(ID)) return false;
+        Reachable.set(ID);
+        WorkList.push_back(ID);
+        return Targets && TargetSet.test(ID);
+    };
+    for (auto ID: Sources)
+        if (Visit(ID)) return true;
+    while (!WorkList.empty()) {
+        unsigned ID = WorkList.back();
+        WorkList.pop_back();
+        for (auto &LabelTargets: DAA->getAliasClassNode(ID)->getOutVertices())
+            for (auto *Target: LabelTargets.second)
+                if (Visit(DAA->getAliasClassID(Target))) return true;
+    }
+    return false;
+}
+
+AliasResult DyckAAResult::alias(const MemoryLocation &LocA, const MemoryLocation &LocB, AAQueryInfo &AAQI) {
+    unsigned IDA = getAliasClassID(LocA.Ptr);
+    unsigned IDB = getAliasClassID(LocB.Ptr);
+    if (IDA == DyckAliasAnalysis::InvalidClassID || IDB == DyckAliasAnalysis::InvalidClassID)
+        return AAResultBase::alias(LocA, LocB, AAQI);
+    unsigned CompA = DAA->getOffsetComponent(IDA), CompB = DAA->getOffsetComponent(IDB);
+    if (CompA != CompB && !DAA->isOpaqueComponent(CompA) && !DAA->isOpaqueComponent(CompB))
+        return AliasResult::NoAlias;
+    return AAResultBase::alias(LocA, LocB, AAQI);
+}
+
+ModRefInfo DyckAAResult::getModRefInfo(const CallBase *Call, const MemoryLocation &Loc, AAQueryInfo &AAQI) {
+    unsigned ID = getAliasClassID(Loc.Ptr);
+    if (ID == DyckAliasAnalysis::InvalidClassID) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+
+    // the objects that the location may be in
+    if (DAA->isOpaqueComponent(DAA->getOffsetComponent(ID))) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+    auto &Objects = ComponentObjects[DAA->getOffsetComponent(ID)];
+    if (Objects.empty()) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+    for (auto Obj: Objects)
+        if (GlobalReachable.test(Obj)) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+
+    // the callee can only access the objects reachable from globals and the arguments
+    std::vector<unsigned> Args;
+    for (auto &Arg: Call->args()) {
+        unsigned ArgID = getAliasClassID(Arg.get());
+        if (ArgID == DyckAliasAnalysis::InvalidClassID) {
+            if (Arg->getType()->isPointerTy()) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+            continue;
+        }
+        Args.push_back(ArgID);
+    }
+    BitVector Reachable(DAA->getNumAliasClasses());
+    if (reach(Args, Reachable, &Objects)) return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+    // a pointer reachable from the arguments that the analysis cannot track may point to the location
+    for (unsigned ReachedID: Reachable.set_bits())
+        if (DAA->isOpaqueComponent(DAA->getOffsetComponent(ReachedID)))
+            return AAResultBase::getModRefInfo(Call, Loc, AAQI);
+    return ModRefInfo::NoModRef;
+}
+
+bool DyckAAResult::invalidate(Module &, const PreservedAnalyses &PA, ModuleAnalysisManager::Invalidator &) {
+    // like GlobalsAA, the result is regarded as stateless unless it is explicitly abandoned,
+    // so that function passes can keep using it via the outer analysis manager proxy.
+    // deleted values are forgotten, so a new value at the address of a deleted one never gets a stale class
+    auto PAC = PA.getChecker<DyckAA>();
+    return !PAC.preservedWhenStateless();
+}
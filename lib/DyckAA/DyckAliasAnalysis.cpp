@@ -16,15 +16,24 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <llvm/ADT/IntEqClasses.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/ModuleSlotTracker.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <stack>
+#include <tuple>
 
 #include "AAAnalyzer.h"
+#include "DyckAA/AliasQueryProfiler.h"
 #include "DyckAA/DyckAliasAnalysis.h"
 #include "DyckAA/DyckCallGraph.h"
 #include "Support/RecursiveTimer.h"
+#include "Support/ThreadPool.h"
 
 static cl::opt<bool> PrintAliasSetInformation("print-alias-set-info", cl::init(false), cl::Hidden,
                                               cl::desc("Output alias sets and their relations"));
@@ -32,6 +41,22 @@ static cl::opt<bool> PrintAliasSetInformation("print-alias-set-info", cl::init(f
 static cl::opt<bool> DotCallGraph("dot-dyck-callgraph", cl::init(false), cl::Hidden,
                                   cl::desc("Calculate the program's call graph and output into a \"dot\" file."));
 
+static cl::opt<std::string> ExportCallGraph("export-dyck-callgraph", cl::init(""), cl::Hidden,
+                                            cl::value_desc("file"),
+                                            cl::desc("Output the program's call graph compactly into the file."));
+
+static cl::opt<std::string> CallGraphFocus("dyck-callgraph-focus", cl::init(""), cl::Hidden,
+                                           cl::value_desc("function"),
+                                           cl::desc("Output the call graph around the function into a \"dot\" "
+                                                    "file, with call instructions as edge labels."));
+
+static cl::opt<unsigned> CallGraphFocusDepth("dyck-callgraph-focus-depth", cl::init(1), cl::Hidden,
+                                             cl::desc("The # calls from or to the focused function to output."));
+
+static cl::opt<unsigned> BenchmarkBatchQueries("dyckaa-benchmark-batch", cl::init(0), cl::Hidden,
+                                              cl::desc("Compare batch alias queries against scalar ones "
+                                                       "using the given # pairs of pointers."));
+
 static cl::opt<bool> CountFP("count-fp", cl::init(false), cl::Hidden,
                              cl::desc("Calculate how many functions a function pointer may point to."));
 
@@ -52,19 +77,334 @@ void DyckAliasAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
     AU.setPreservesAll();
 }
 
-const std::set<Value *> *DyckAliasAnalysis::getAliasSet(Value *Ptr) const {
-    DyckGraphNode *V = DyckPTG->retrieveDyckVertex(Ptr).first;
-    return (const std::set<Value *> *) V->getEquivalentSet();
+ArrayRef<Value *> DyckAliasAnalysis::getAliasSet(const Value *Ptr) const {
+    AliasQueryProfiler::Sample S(AliasQueryProfiler::QK_AliasSet);
+    unsigned ID = getAliasClassID(Ptr);
+    if (ID == InvalidClassID) return {};
+    auto Members = getAliasClassMembers(ID);
+    S.setClassSize(Members.size());
+    return Members;
+}
+
+bool DyckAliasAnalysis::mayAlias(const Value *V1, const Value *V2) const {
+    AliasQueryProfiler::Sample S(AliasQueryProfiler::QK_MayAlias);
+    if (V1 == V2) return true;
+    unsigned ID1 = getAliasClassID(V1);
+    if (ID1 == InvalidClassID) return false;
+    if (AliasQueryProfiler::enabled()) S.setClassSize(ClassOffsets[ID1 + 1] - ClassOffsets[ID1]);
+    return ID1 == getAliasClassID(V2);
+}
+
+bool DyckAliasAnalysis::mayNull(const Value *V) const {
+    AliasQueryProfiler::Sample S(AliasQueryProfiler::QK_MayNull);
+    unsigned ID = getAliasClassID(V);
+    // nothing is known about the values outside a slice
+    if (ID == InvalidClassID) return Sliced;
+    if (AliasQueryProfiler::enabled()) S.setClassSize(ClassOffsets[ID + 1] - ClassOffsets[ID]);
+    return ClassMayNull.test(ID);
+}
+
+unsigned DyckAliasAnalysis::getAliasClassID(const Value *V) const {
+    auto It = ValueClassMap.find(V);
+    return It == ValueClassMap.end() ? InvalidClassID : It->second;
+}
+
+unsigned DyckAliasAnalysis::getAliasClassID(const DyckGraphNode *N) const {
+    auto It = NodeClassMap.find(N);
+    return It == NodeClassMap.end() ? InvalidClassID : It->second;
+}
+
+BitVector DyckAliasAnalysis::mayAliasBatch(ArrayRef<std::pair<const Value *, const Value *>> Pairs) const {
+    AliasQueryProfiler::Sample S(AliasQueryProfiler::QK_MayAliasBatch);
+    // look up the ids first; unknown values get ids that never equal any class id,
+    // and V2 takes the id of V1 if they are the same value.
+    // clients usually query one pointer against many, so the last lookup of V1 is reused
+    std::vector<unsigned> IDs1(Pairs.size()), IDs2(Pairs.size());
+    const Value *LastV1 = nullptr;
+    unsigned LastID1 = InvalidClassID;
+    for (unsigned K = 0; K < Pairs.size(); ++K) {
+        const Value *V1 = Pairs[K].first, *V2 = Pairs[K].second;
+        if (V1 != LastV1) {
+            LastV1 = V1;
+            LastID1 = getAliasClassID(V1);
+        }
+        IDs1[K] = LastID1;
+        if (V1 == V2) {
+            IDs2[K] = LastID1;
+        } else {
+            IDs2[K] = getAliasClassID(V2);
+            if (IDs2[K] == InvalidClassID) IDs2[K] = InvalidClassID - 1;
+        }
+    }
+
+    // compare into a byte per pair and pack the bytes into 32-bit words, both plain loops over arrays
+    // that compilers can vectorize, and then hand the words to the bit vector at once
+    unsigned NumPairs = Pairs.size(), NumWords = (NumPairs + 31) / 32;
+    std::vector<uint8_t> Equal(NumWords * 32, 0);
+    const unsigned *P1 = IDs1.data(), *P2 = IDs2.data();
+    uint8_t *PE = Equal.data();
+    for (unsigned K = 0; K < NumPairs; ++K) PE[K] = P1[K] == P2[K];
+    std::vector<uint32_t> Mask(NumWords);
+    for (unsigned W = 0; W < NumWords; ++W) {
+        uint32_t Word = 0;
+        for (unsigned J = 0; J < 32; ++J) Word |= (uint32_t) PE[W * 32 + J] << J;
+        Mask[W] = Word;
+    }
+    BitVector Ret(NumPairs);
+    Ret.setBitsInMask(Mask.data(), NumWords);
+    return Ret;
+}
+
+std::vector<unsigned> DyckAliasAnalysis::aliasPartition(const Function &F, std::vector<const Value *> *Pointers) const {
+    std::vector<unsigned> Ret;
+    DenseMap<const Value *, unsigned> FreshIDs;
+    for (auto &B: F) {
+        for (auto &I: B) {
+            for (auto &Op: I.operands()) {
+                const Value *V = Op.get();
+                if (!V->getType()->isPointerTy()) continue;
+                unsigned ID = getAliasClassID(V);
+                if (ID == InvalidClassID)
+                    ID = FreshIDs.insert(std::make_pair(V, getNumAliasClasses() + FreshIDs.size())).first->second;
+                Ret.push_back(ID);
+                if (Pointers) Pointers->push_back(V);
+            }
+        }
+    }
+    return Ret;
+}
+
+void DyckAliasAnalysis::benchmarkBatchQueries(Module &M) const {
+    // pairs of pointer operands in the same function, which is what clients usually query
+    std::vector<std::pair<const Value *, const Value *>> Pairs;
+    for (auto &F: M) {
+        std::vector<const Value *> Pointers;
+        aliasPartition(F, &Pointers);
+        for (unsigned K = 0; K < Pointers.size() && Pairs.size() < BenchmarkBatchQueries; ++K)
+            for (unsigned J = K + 1; J < Pointers.size() && Pairs.size() < BenchmarkBatchQueries; ++J)
+                Pairs.emplace_back(Pointers[K], Pointers[J]);
+        if (Pairs.size() >= BenchmarkBatchQueries) break;
+    }
+
+    auto Begin = std::chrono::steady_clock::now();
+    BitVector Scalar(Pairs.size());
+    for (unsigned K = 0; K < Pairs.size(); ++K)
+        if (mayAlias(Pairs[K].first, Pairs[K].second)) Scalar.set(K);
+    auto Middle = std::chrono::steady_clock::now();
+    BitVector Batch = mayAliasBatch(Pairs);
+    auto End = std::chrono::steady_clock::now();
+
+    auto ScalarUs = std::chrono::duration_cast<std::chrono::microseconds>(Middle - Begin).count();
+    auto BatchUs = std::chrono::duration_cast<std::chrono::microseconds>(End - Middle).count();
+    outs() << "Alias queries on " << Pairs.size() << " pairs: scalar " << ScalarUs << "us, batch " << BatchUs
+           << "us, " << (Scalar == Batch ? "same results" : "DIFFERENT RESULTS") << "\n";
+
+    // bucketing all pointer operands of each function, compared with pairwise scalar queries
+    unsigned long NumPointers = 0, NumScalarAliases = 0, NumPartitionAliases = 0;
+    Begin = std::chrono::steady_clock::now();
+    for (auto &F: M) {
+        std::vector<const Value *> Pointers;
+        aliasPartition(F, &Pointers);
+        NumPointers += Pointers.size();
+        for (unsigned K = 0; K < Pointers.size(); ++K)
+            for (unsigned J = K + 1; J < Pointers.size(); ++J)
+                NumScalarAliases += mayAlias(Pointers[K], Pointers[J]);
+    }
+    Middle = std::chrono::steady_clock::now();
+    for (auto &F: M) {
+        std::vector<unsigned> IDs = aliasPartition(F);
+        std::sort(IDs.begin(), IDs.end());
+        for (unsigned K = 0; K < IDs.size();) {
+            unsigned J = K;
+            while (J < IDs.size() && IDs[J] == IDs[K]) ++J;
+            NumPartitionAliases += (unsigned long) (J - K) * (J - K - 1) / 2;
+            K = J;
+        }
+    }
+    End = std::chrono::steady_clock::now();
+    ScalarUs = std::chrono::duration_cast<std::chrono::microseconds>(Middle - Begin).count();
+    auto PartitionUs = std::chrono::duration_cast<std::chrono::microseconds>(End - Middle).count();
+    outs() << "Alias pairs among " << NumPointers << " pointer operands: scalar " << ScalarUs << "us, partition "
+           << PartitionUs << "us, "
+           << (NumScalarAliases == NumPartitionAliases ? "same results" : "DIFFERENT RESULTS") << "\n";
 }
 
-bool DyckAliasAnalysis::mayAlias(Value *V1, Value *V2) const {
-    return getAliasSet(V1)->count(V2);
+/// a deterministic order of edge labels
+static std::pair<int, long> getLabelKey(void *Label) {
+    auto *L = (DyckGraphEdgeLabel *) Label;
+    if (L->isLabelTy(DyckGraphEdgeLabel::LT_Dereference)) return {0, 0};
+    if (L->isLabelTy(DyckGraphEdgeLabel::LT_Index)) return {1, ((FieldIndexEdgeLabel *) L)->getFieldIndex()};
+    if (L->isLabelTy(DyckGraphEdgeLabel::LT_Offset)) return {2, ((PointerOffsetEdgeLabel *) L)->getOffsetBytes()};
+    return {3, 0};
 }
 
-bool DyckAliasAnalysis::mayNull(Value *V) const {
-    auto *DyckNode = DyckPTG->findDyckVertex(V);
-    if (!DyckNode) return false;
-    return DyckNode->containsNull();
+/// order the vertices by their first members in the module, or by the first uses of their members, e.g.,
+/// constants. vertices without such members follow in the order they are reached from the ordered ones.
+/// thus, the class ids do not depend on the addresses of the vertices
+static std::vector<DyckGraphNode *> getStableVertexOrder(Module &M, DyckGraph *DG) {
+    DenseMap<const Value *, unsigned> Positions;
+    auto AddPosition = [&Positions](const Value *V) { Positions.try_emplace(V, Positions.size()); };
+    for (auto &G: M.global_values()) AddPosition(&G);
+    for (auto &F: M) {
+        for (auto &Arg: F.args()) AddPosition(&Arg);
+        for (auto &I: instructions(F)) AddPosition(&I);
+    }
+
+    // (0, position of the member, 0) or (1, position of the user, operand number)
+    typedef std::tuple<unsigned, unsigned, unsigned> KeyTy;
+    const KeyTy NoKey(2, 0, 0);
+    std::vector<std::pair<KeyTy, DyckGraphNode *>> Keyed;
+    std::vector<DyckGraphNode *> Unkeyed;
+    for (auto *N: DG->getVertices()) {
+        KeyTy Key = NoKey;
+        for (auto *V: *N->getEquivalentSet()) {
+            auto It = Positions.find((Value *) V);
+            if (It != Positions.end()) Key = std::min(Key, KeyTy(0, It->second, 0));
+        }
+        if (Key == NoKey) {
+            for (auto *V: *N->getEquivalentSet()) {
+                for (auto &U: ((Value *) V)->uses()) {
+                    auto It = Positions.find(U.getUser());
+                    if (It != Positions.end()) Key = std::min(Key, KeyTy(1, It->second, U.getOperandNo()));
+                }
+            }
+        }
+        if (Key == NoKey) Unkeyed.push_back(N);
+        else Keyed.emplace_back(Key, N);
+    }
+    std::sort(Keyed.begin(), Keyed.end(), [](const std::pair<KeyTy, DyckGraphNode *> &A,
+                                             const std::pair<KeyTy, DyckGraphNode *> &B) {
+        return A.first < B.first;
+    });
+
+    std::vector<DyckGraphNode *> Ret;
+    Ret.reserve(DG->getVertices().size());
+    std::set<DyckGraphNode *> Placed;
+    for (auto &It: Keyed) {
+        Ret.push_back(It.second);
+        Placed.insert(It.second);
+    }
+    for (unsigned K = 0; K < Ret.size(); ++K) {
+        std::vector<std::pair<std::pair<int, long>, DyckGraphNode *>> Targets;
+        for (auto &LabelTargets: Ret[K]->getOutVertices())
+            for (auto *Target: LabelTargets.second)
+                if (!Placed.count(Target)) Targets.emplace_back(getLabelKey(LabelTargets.first), Target);
+        // a label has at most one target after solving, unless the solving is interrupted
+        std::sort(Targets.begin(), Targets.end(), [](const std::pair<std::pair<int, long>, DyckGraphNode *> &A,
+                                                     const std::pair<std::pair<int, long>, DyckGraphNode *> &B) {
+            return A.first != B.first ? A.first < B.first : A.second->getIndex() < B.second->getIndex();
+        });
+        for (auto &It: Targets)
+            if (Placed.insert(It.second).second) Ret.push_back(It.second);
+    }
+    // the rest are not reachable from any value
+    std::sort(Unkeyed.begin(), Unkeyed.end(), [](DyckGraphNode *A, DyckGraphNode *B) {
+        return A->getIndex() < B->getIndex();
+    });
+    for (auto *N: Unkeyed)
+        if (Placed.insert(N).second) Ret.push_back(N);
+    return Ret;
+}
+
+void DyckAliasAnalysis::freeze(Module &M, const std::vector<Value *> &OpaqueValues) {
+    auto Vertices = getStableVertexOrder(M, DyckPTG);
+    NodeClassMap.reserve(Vertices.size());
+    ClassNodes.reserve(Vertices.size());
+    ClassOffsets.reserve(Vertices.size() + 1);
+    ClassMayNull.resize(Vertices.size());
+
+    unsigned NumValues = 0;
+    for (auto *DyckNode: Vertices) NumValues += DyckNode->getEquivalentSet()->size();
+    ValueClassMap.reserve(NumValues);
+    ClassMembers.reserve(NumValues);
+
+    // each vertex is a class, including those without any value, e.g., an anonymous object
+    for (auto *DyckNode: Vertices) {
+        unsigned ID = ClassOffsets.size();
+        NodeClassMap[DyckNode] = ID;
+        ClassNodes.push_back(DyckNode);
+        ClassOffsets.push_back(ClassMembers.size());
+        if (DyckNode->containsNull()) ClassMayNull.set(ID);
+        for (auto *V: *DyckNode->getEquivalentSet()) {
+            ValueClassMap[(Value *) V] = ID;
+            ClassMembers.push_back((Value *) V);
+        }
+    }
+    ClassOffsets.push_back(ClassMembers.size());
+
+    // one deref step and the fields of its target, so that clients need not walk the graph
+    auto *DerefLabel = DyckPTG->getDereferenceEdgeLabel();
+    ClassPointsTo.assign(ClassNodes.size(), (unsigned) InvalidClassID);
+    ClassFieldOffsets.reserve(ClassNodes.size() + 1);
+    for (unsigned ID = 0; ID < ClassNodes.size(); ++ID) {
+        ClassFieldOffsets.push_back(ClassFields.size());
+        for (auto &LabelTargets: ClassNodes[ID]->getOutVertices()) {
+            auto *Label = (DyckGraphEdgeLabel *) LabelTargets.first;
+            if (Label == DerefLabel) {
+                assert(LabelTargets.second.size() <= 1 && "A pointer should point to one class after solving!");
+                if (!LabelTargets.second.empty()) ClassPointsTo[ID] = NodeClassMap.lookup(*LabelTargets.second.begin());
+            } else if (Label->isLabelTy(DyckGraphEdgeLabel::LT_Index)) {
+                long FieldIdx = ((FieldIndexEdgeLabel *) Label)->getFieldIndex();
+                for (auto *Field: LabelTargets.second) ClassFields.emplace_back(FieldIdx, NodeClassMap.lookup(Field));
+            }
+        }
+        std::sort(ClassFields.begin() + ClassFieldOffsets.back(), ClassFields.end());
+    }
+    ClassFieldOffsets.push_back(ClassFields.size());
+
+    // union classes connected by offset edges
+    IntEqClasses Components(ClassNodes.size());
+    for (unsigned ID = 0; ID < ClassNodes.size(); ++ID) {
+        for (auto &LabelTargets: ClassNodes[ID]->getOutVertices()) {
+            auto *Label = (DyckGraphEdgeLabel *) LabelTargets.first;
+            if (!Label->isLabelTy(DyckGraphEdgeLabel::LT_Offset)) continue;
+            for (auto *Target: LabelTargets.second) Components.join(ID, NodeClassMap.lookup(Target));
+        }
+    }
+    Components.compress();
+    NumOffsetComponents = Components.getNumClasses();
+    ClassOffsetComponents.resize(ClassNodes.size());
+    for (unsigned ID = 0; ID < ClassNodes.size(); ++ID) ClassOffsetComponents[ID] = Components[ID];
+
+    // a pointer that the analysis cannot track may point to anything, and so may the pointers loaded via it
+    BitVector Opaque(ClassNodes.size());
+    std::vector<unsigned> WorkList;
+    for (auto *V: OpaqueValues) {
+        unsigned ID = getAliasClassID(V);
+        if (ID == InvalidClassID || Opaque.test(ID)) continue;
+        Opaque.set(ID);
+        WorkList.push_back(ID);
+    }
+    while (!WorkList.empty()) {
+        unsigned ID = WorkList.back();
+        WorkList.pop_back();
+        for (auto &LabelTargets: ClassNodes[ID]->getOutVertices()) {
+            for (auto *Target: LabelTargets.second) {
+                unsigned TargetID = NodeClassMap.lookup(Target);
+                if (Opaque.test(TargetID)) continue;
+                Opaque.set(TargetID);
+                WorkList.push_back(TargetID);
+            }
+        }
+    }
+    OpaqueComponents.resize(NumOffsetComponents);
+    for (unsigned ID: Opaque.set_bits()) OpaqueComponents.set(ClassOffsetComponents[ID]);
+}
+
+unsigned DyckAliasAnalysis::pointsTo(const Value *V) const {
+    AliasQueryProfiler::Sample S(AliasQueryProfiler::QK_PointsTo);
+    unsigned ID = getAliasClassID(V);
+    if (ID == InvalidClassID) return InvalidClassID;
+    if (AliasQueryProfiler::enabled()) S.setClassSize(ClassOffsets[ID + 1] - ClassOffsets[ID]);
+    return ClassPointsTo[ID];
+}
+
+unsigned DyckAliasAnalysis::pointsToField(const Value *V, long FieldIdx) const {
+    unsigned ObjID = pointsTo(V);
+    if (ObjID == InvalidClassID) return InvalidClassID;
+    auto Fields = getClassFields(ObjID);
+    auto It = std::lower_bound(Fields.begin(), Fields.end(), std::make_pair(FieldIdx, 0U));
+    return It != Fields.end() && It->first == FieldIdx ? It->second : InvalidClassID;
 }
 
 DyckCallGraph *DyckAliasAnalysis::getDyckCallGraph() const {
@@ -77,11 +417,13 @@ DyckGraph *DyckAliasAnalysis::getDyckGraph() const {
 
 bool DyckAliasAnalysis::runOnModule(Module &M) {
     RecursiveTimer DyckAA("Running DyckAA");
+    AliasQueryProfiler::ClientScope Client("DyckAliasAnalysis");
 
     // alias analysis
     AAAnalyzer AA(&M, DyckPTG, DyckCG);
     AA.intraProcedureAnalysis();
     AA.interProcedureAnalysis();
+    Sliced = AA.isSliced();
 
     // a post-processing procedure
     for (auto *DyckNode: DyckPTG->getVertices()) {
@@ -94,6 +436,9 @@ bool DyckAliasAnalysis::runOnModule(Module &M) {
         }
     }
 
+    freeze(M, AA.getOpaqueValues());
+    if (BenchmarkBatchQueries) benchmarkBatchQueries(M);
+
     /* call graph */
     if (DotCallGraph) {
         outs() << "Printing call graph...\n";
@@ -101,6 +446,26 @@ bool DyckAliasAnalysis::runOnModule(Module &M) {
         outs() << "Done!\n\n";
     }
 
+    if (!ExportCallGraph.empty()) {
+        outs() << "Exporting call graph...\n";
+        std::error_code EC;
+        raw_fd_ostream OS(ExportCallGraph, EC);
+        if (EC) errs() << "Cannot open " << ExportCallGraph << ": " << EC.message() << "\n";
+        else DyckCG->exportCallGraph(OS);
+        outs() << "Done!\n\n";
+    }
+
+    if (!CallGraphFocus.empty()) {
+        if (auto *Focus = M.getFunction(CallGraphFocus)) {
+            outs() << "Printing call graph around " << CallGraphFocus << "...\n";
+            DyckCG->dotCallGraphFocus(M.getModuleIdentifier() + "." + CallGraphFocus + ".maycg.dot", Focus,
+                                      CallGraphFocusDepth);
+            outs() << "Done!\n\n";
+        } else {
+            errs() << "Function " << CallGraphFocus << " is not found!\n";
+        }
+    }
+
     if (CountFP) {
         outs() << "Printing function pointer information...\n";
         DyckCG->printFunctionPointersInformation(M.getModuleIdentifier());
@@ -109,7 +474,7 @@ bool DyckAliasAnalysis::runOnModule(Module &M) {
 
     if (PrintAliasSetInformation) {
         outs() << "Printing alias set information...\n";
-        this->printAliasSetInformation();
+        this->printAliasSetInformation(M);
         outs() << "Done!\n\n";
     }
 
@@ -118,155 +483,137 @@ bool DyckAliasAnalysis::runOnModule(Module &M) {
     return false;
 }
 
-void DyckAliasAnalysis::printAliasSetInformation() {
-    /*if (InterAAEval)*/
-    {
-        std::set<DyckGraphNode *> &AllReps = DyckPTG->getVertices();
+/// Format the alias classes [Begin, End) in the alias_sets.log layout. Members are printed
+/// grouped by their parent function so that the slot tracker numbers each function once,
+/// then put back in their original order.
+static std::string formatAliasSets(const Module &M, ArrayRef<Value *> Members, ArrayRef<unsigned> Offsets,
+                                   unsigned Begin, unsigned End) {
+    unsigned First = Offsets[Begin];
+    unsigned NumMembers = Offsets[End] - First;
+
+    auto GetParent = [](const Value *V) -> const Function * {
+        if (auto *I = dyn_cast<Instruction>(V)) return I->getFunction();
+        if (auto *A = dyn_cast<Argument>(V)) return A->getParent();
+        return nullptr;
+    };
+    std::vector<unsigned> Order(NumMembers);
+    for (unsigned K = 0; K < NumMembers; ++K) Order[K] = K;
+    std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+        return std::less<const Function *>()(GetParent(Members[First + A]), GetParent(Members[First + B]));
+    });
+
+    ModuleSlotTracker MST(&M);
+    std::vector<std::string> Texts(NumMembers);
+    for (unsigned K: Order) {
+        auto *Val = Members[First + K];
+        assert(Val != nullptr && "Error: val is null in an equiv set!");
+        raw_string_ostream OS(Texts[K]);
+        if (isa<Function>(Val)) OS << Val->getName();
+        else Val->print(OS, MST);
+    }
 
-        outs() << "Printing distribution.log... ";
-        outs().flush();
-        FILE *Log = fopen("distribution.log", "w+");
+    std::string Result;
+    raw_string_ostream OS(Result);
+    for (unsigned ID = Begin; ID < End; ++ID) {
+        for (unsigned K = Offsets[ID]; K < Offsets[ID + 1]; ++K)
+            OS << "[" << ID + 1 << "]" << Texts[K - First] << "\n";
+        OS << "\n------------------------------\n";
+    }
+    return OS.str();
+}
 
-        std::vector<unsigned long> AliasSetSizes;
-        unsigned TotalSize = 0;
-        auto It = AllReps.begin();
-        while (It != AllReps.end()) {
-            std::set<void *> *AliasSet = (*It)->getEquivalentSet();
+void DyckAliasAnalysis::printAliasSetInformation(const Module &M) {
+    unsigned NumClasses = getNumAliasClasses();
 
+    // distribution.log, the size of each class counting pointers only
+    unsigned long TotalSize = 0, SquareSum = 0, MaxSize = 0, NumSets = 0;
+    auto PrintDistribution = [&]() {
+        std::error_code EC;
+        raw_fd_ostream Log("distribution.log", EC);
+        for (unsigned ID = 0; ID < NumClasses; ++ID) {
             unsigned long Size = 0;
-
-            auto AsIt = AliasSet->begin();
-            while (AsIt != AliasSet->end()) {
-                auto *Val = (Value *) (*AsIt);
-                if (Val->getType()->isPointerTy())
-                    Size++;
-                AsIt++;
-            }
-
-            if (Size != 0) {
-                TotalSize = TotalSize + Size;
-                AliasSetSizes.push_back(Size);
-                fprintf(Log, "%lu\n", Size);
-            }
-
-            It++;
+            for (auto *Val: getAliasClassMembers(ID))
+                if (Val->getType()->isPointerTy()) Size++;
+            if (Size == 0) continue;
+            TotalSize += Size;
+            SquareSum += Size * Size;
+            MaxSize = std::max(MaxSize, Size);
+            NumSets++;
+            Log << Size << "\n";
         }
-        errs() << TotalSize << "\n";
-        double PairNum = (((double) TotalSize - 1) / 2) * TotalSize;
-
-        unsigned NoAliasNum = 0;
-        for (unsigned K = 0; K < AliasSetSizes.size(); K++) {
-            unsigned KSize = AliasSetSizes[K];
-            for (unsigned J = K + 1; J < AliasSetSizes.size(); J++) {
-                NoAliasNum = NoAliasNum + KSize * AliasSetSizes[J];
-            }
-        }
-        //errs() << noAliasNum << "\n";
-
-        double PercentOfNoAlias = NoAliasNum / (double) PairNum * 100;
+    };
 
-        fclose(Log);
-        outs() << "Done!\n";
-
-        outs() << "===== Alias Analysis Evaluator Report =====\n";
-        outs() << "   " << PairNum << " Total Alias Queries Performed\n";
-        outs() << "   " << NoAliasNum << " no alias responses (" << (unsigned long) PercentOfNoAlias << "%)\n\n";
-    }
-
-    /*if (DotAliasSet) */
-    {
-        outs() << "Printing alias_rel.dot... ";
-        outs().flush();
-
-        FILE *AliasRel = fopen("alias_rel.dot", "w");
-        fprintf(AliasRel, "digraph rel{\n");
-
-        std::map<DyckGraphNode *, int> TheMap;
-        int Idx = 0;
-        std::set<DyckGraphNode *> &Reps = DyckPTG->getVertices();
-        auto RepIt = Reps.begin();
-        while (RepIt != Reps.end()) {
-            Idx++;
-            fprintf(AliasRel, "a%d[label=%d];\n", Idx, Idx);
-            TheMap.insert(std::pair<DyckGraphNode *, int>(*RepIt, Idx));
-            RepIt++;
-        }
-
-        RepIt = Reps.begin();
-        while (RepIt != Reps.end()) {
-            DyckGraphNode *DGN = *RepIt;
-            std::map<void *, std::set<DyckGraphNode *>> &OutVs = DGN->getOutVertices();
-
-            auto OvIt = OutVs.begin();
-            while (OvIt != OutVs.end()) {
-                auto *Label = (DyckGraphEdgeLabel *) OvIt->first;
-                std::set<DyckGraphNode *> *oVs = &OvIt->second;
-
-                auto OIt = oVs->begin();
-                while (OIt != oVs->end()) {
-                    DyckGraphNode *Rep1 = DGN;
-                    DyckGraphNode *Rep2 = (*OIt);
-
-                    assert(TheMap.count(Rep1) && "ERROR in DotAliasSet (1)\n");
-                    assert(TheMap.count(Rep2) && "ERROR in DotAliasSet (2)\n");
-
-                    int Idx1 = TheMap[Rep1];
-                    int Idx2 = TheMap[Rep2];
-                    fprintf(AliasRel, "a%d->a%d[label=\"%s\"];\n", Idx1, Idx2, Label->getEdgeLabelDescription().data());
-
-                    OIt++;
+    // alias_rel.dot, the i-th class is named a<i>
+    auto PrintRelation = [&]() {
+        std::error_code EC;
+        raw_fd_ostream AliasRel("alias_rel.dot", EC);
+        AliasRel << "digraph rel{\n";
+        for (unsigned ID = 1; ID <= NumClasses; ++ID)
+            AliasRel << "a" << ID << "[label=" << ID << "];\n";
+        for (unsigned ID = 0; ID < NumClasses; ++ID) {
+            for (auto &OutIt: getAliasClassNode(ID)->getOutVertices()) {
+                auto *Label = (DyckGraphEdgeLabel *) OutIt.first;
+                for (auto *Target: OutIt.second) {
+                    assert(NodeClassMap.count(Target) && "ERROR in DotAliasSet\n");
+                    AliasRel << "a" << ID + 1 << "->a" << NodeClassMap.lookup(Target) + 1 << "[label=\""
+                             << Label->getEdgeLabelDescription() << "\"];\n";
                 }
-
-                OvIt++;
             }
-
-            TheMap.insert(std::pair<DyckGraphNode *, int>(*RepIt, Idx));
-            RepIt++;
         }
-
-        fprintf(AliasRel, "}\n");
-        fclose(AliasRel);
-        outs() << "Done!\n";
+        AliasRel << "}\n";
+    };
+
+    // alias_sets.log, classes are formatted in chunks of similar # members
+    unsigned NumChunks = 4 * std::max(1U, ThreadPool::get()->numWorkers());
+    size_t ChunkMembers = ClassMembers.size() / NumChunks + 1;
+    std::vector<std::pair<unsigned, unsigned>> Chunks;
+    for (unsigned Begin = 0; Begin < NumClasses;) {
+        unsigned End = Begin + 1;
+        while (End < NumClasses && ClassOffsets[End] - ClassOffsets[Begin] < ChunkMembers) ++End;
+        Chunks.emplace_back(Begin, End);
+        Begin = End;
+    }
+    std::vector<std::string> ChunkTexts(Chunks.size());
+
+    ThreadPool::get()->enqueue(PrintDistribution);
+    ThreadPool::get()->enqueue(PrintRelation);
+    for (unsigned K = 0; K < Chunks.size(); ++K) {
+        ThreadPool::get()->enqueue([&, K]() {
+            ChunkTexts[K] = formatAliasSets(M, ClassMembers, ClassOffsets, Chunks[K].first, Chunks[K].second);
+        });
     }
+    ThreadPool::get()->wait();
 
-    /*if (OutputAliasSet)*/
     {
-        outs() << "Printing alias_sets.log... ";
-        outs().flush();
-
         std::error_code EC;
         raw_fd_ostream Log("alias_sets.log", EC);
-
         Log << "================= Alias Sets ==================\n";
         Log << "===== {.} means pthread escaped alias set =====\n";
+        for (auto &Text: ChunkTexts) Log << Text;
+    }
 
-        int Idx = 0;
-        std::set<DyckGraphNode *> &Reps = DyckPTG->getVertices();
-        auto RepsIt = Reps.begin();
-        while (RepsIt != Reps.end()) {
-            Idx++;
-            DyckGraphNode *Rep = *RepsIt;
-
-            std::set<void *> *ESet = Rep->getEquivalentSet();
-            auto EIt = ESet->begin();
-            while (EIt != ESet->end()) {
-                auto *Val = (Value *) ((*EIt));
-                assert(Val != nullptr && "Error: val is null in an equiv set!");
-                Log << "[" << Idx << "]";
-
-                if (isa<Function>(Val)) {
-                    Log << ((Function *) Val)->getName() << "\n";
-                } else {
-                    Log << *Val << "\n";
-                }
-                EIt++;
-            }
-            RepsIt++;
-            Log << "\n------------------------------\n";
-        }
+    // each pair of pointers in different classes is a no-alias pair
+    double PairNum = (((double) TotalSize - 1) / 2) * TotalSize;
+    unsigned long NoAliasNum = (TotalSize * TotalSize - SquareSum) / 2;
+    double PercentOfNoAlias = PairNum == 0 ? 0 : NoAliasNum / PairNum * 100;
 
-        Log.flush();
-        Log.close();
-        outs() << "Done! \n";
+    {
+        std::error_code EC;
+        raw_fd_ostream Summary("alias_summary.json", EC);
+        json::OStream J(Summary, 2);
+        J.object([&] {
+            J.attribute("classes", (int64_t) NumClasses);
+            J.attribute("pointer_classes", (int64_t) NumSets);
+            J.attribute("pointers", (int64_t) TotalSize);
+            J.attribute("max_class_size", (int64_t) MaxSize);
+            J.attribute("queries", PairNum);
+            J.attribute("no_alias", (int64_t) NoAliasNum);
+            J.attribute("no_alias_percent", PercentOfNoAlias);
+        });
+        Summary << "\n";
     }
+
+    outs() << "===== Alias Analysis Evaluator Report =====\n";
+    outs() << "   " << PairNum << " Total Alias Queries Performed\n";
+    outs() << "   " << NoAliasNum << " no alias responses (" << (unsigned long) PercentOfNoAlias << "%)\n\n";
 }
@@ -16,27 +16,30 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
 #include "DyckAA/DyckCallGraph.h"
+#include "Support/ThreadPool.h"
 
 static cl::opt<bool> WithEdgeLabels("with-labels", cl::init(false), cl::Hidden,
                                     cl::desc("Determine whether there are edge lables in the cg."));
 
-DyckCallGraph::DyckCallGraph() : ExternalCallingNode(getOrInsertFunction(nullptr)) {
+DyckCallGraph::DyckCallGraph() : NumCalls(0), ExternalCallingNode(nullptr) {
+    ExternalCallingNode = getOrInsertFunction(nullptr);
 }
 
-DyckCallGraph::~DyckCallGraph() {
-    auto It = FunctionMap.begin();
-    while (It != FunctionMap.end()) {
-        delete (It->second);
-        It++;
-    }
-    FunctionMapTy().swap(FunctionMap);
-}
+// the arenas destroy all nodes and calls
+DyckCallGraph::~DyckCallGraph() = default;
 
 DyckCallGraphNode *DyckCallGraph::getOrInsertFunction(Function *Func) {
-    auto It = FunctionMap.find(Func);
-    if (It == FunctionMap.end()) {
-        auto *Ret = new DyckCallGraphNode(Func);
+    auto It = FunctionIDs.find(Func);
+    if (It == FunctionIDs.end()) {
+        unsigned ID = Nodes.size();
+        auto *Ret = new(NodeAllocator.Allocate()) DyckCallGraphNode(Func, ID);
 
         // The following if-statement is copied from llvm's call graph implementation
         // If this function has external linkage or has its address taken and
@@ -44,117 +47,286 @@ DyckCallGraphNode *DyckCallGraph::getOrInsertFunction(Function *Func) {
         if (Func && (!Func->hasLocalLinkage() || Func->hasAddressTaken(nullptr, /*IgnoreCallbackUses=*/true)))
             ExternalCallingNode->addCalledFunction(nullptr, Ret);
 
-        FunctionMap.emplace(Func, Ret);
+        FunctionIDs[Func] = ID;
+        Nodes.push_back(Ret);
         return Ret;
     }
-    return It->second;
+    return Nodes[It->second];
 }
 
 DyckCallGraphNode *DyckCallGraph::getFunction(Function *Func) const {
-    auto It = FunctionMap.find(Func);
-    if (It == FunctionMap.end()) return nullptr;
-    return It->second;
+    auto It = FunctionIDs.find(Func);
+    if (It == FunctionIDs.end()) return nullptr;
+    return Nodes[It->second];
 }
 
-void DyckCallGraph::dotCallGraph(const std::string &ModuleIdentifier) {
-    std::string DotFileName;
-    DotFileName.append(ModuleIdentifier);
-    DotFileName.append(".maycg.dot");
+CommonCall *DyckCallGraph::createCommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args) {
+    return new(CommonCallAllocator.Allocate()) CommonCall(Inst, Func, Args, ++NumCalls);
+}
 
-    FILE *FOut = fopen(DotFileName.data(), "w+");
-    fprintf(FOut, "digraph maycg {\n");
+PointerCall *DyckCallGraph::createPointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args) {
+    return new(PointerCallAllocator.Allocate()) PointerCall(Inst, CalledValue, Args, ++NumCalls);
+}
 
-    auto FWIt = FunctionMap.begin();
-    while (FWIt != FunctionMap.end()) {
-        DyckCallGraphNode *FW = FWIt->second;
-        fprintf(FOut, "\tf%p[label=\"%s\"]\n", FW, FW->getLLVMFunction()->getName().data());
-        FWIt++;
+void DyckCallGraph::computeSCCs() {
+    unsigned NumNodes = Nodes.size();
+    NodeSCCs.assign(NumNodes, 0);
+    SCCNodes.clear();
+    SCCOffsets.clear();
+
+    // iterative tarjan, indices start from 1 so that 0 means unvisited
+    std::vector<unsigned> Index(NumNodes, 0), LowLink(NumNodes, 0);
+    std::vector<bool> OnStack(NumNodes, false);
+    std::vector<unsigned> Stack;
+    std::vector<std::pair<unsigned, unsigned>> DFSStack; // (node, the next child to visit)
+    unsigned Counter = 0;
+    auto Visit = [&](unsigned V) {
+        Index[V] = LowLink[V] = ++Counter;
+        Stack.push_back(V);
+        OnStack[V] = true;
+        DFSStack.emplace_back(V, 0);
+    };
+    for (unsigned Root = 0; Root < NumNodes; ++Root) {
+        if (Index[Root]) continue;
+        Visit(Root);
+        while (!DFSStack.empty()) {
+            unsigned V = DFSStack.back().first;
+            auto *VN = Nodes[V];
+            unsigned Child = DFSStack.back().second++;
+            if (Child < VN->child_edge_end() - VN->child_edge_begin()) {
+                unsigned W = (VN->child_edge_begin() + Child)->second->getID();
+                if (!Index[W]) Visit(W);
+                else if (OnStack[W]) LowLink[V] = std::min(LowLink[V], Index[W]);
+                continue;
+            }
+
+            DFSStack.pop_back();
+            if (!DFSStack.empty()) {
+                unsigned Parent = DFSStack.back().first;
+                LowLink[Parent] = std::min(LowLink[Parent], LowLink[V]);
+            }
+            if (LowLink[V] != Index[V]) continue;
+
+            unsigned SCCID = SCCOffsets.size();
+            SCCOffsets.push_back(SCCNodes.size());
+            unsigned W;
+            do {
+                W = Stack.back();
+                Stack.pop_back();
+                OnStack[W] = false;
+                NodeSCCs[W] = SCCID;
+                SCCNodes.push_back(Nodes[W]);
+            } while (W != V);
+        }
     }
+    SCCOffsets.push_back(SCCNodes.size());
 
-    FWIt = FunctionMap.begin();
-    while (FWIt != FunctionMap.end()) {
-        DyckCallGraphNode *FW = FWIt->second;
-        auto CCIt = FW->common_call_begin();
-        while (CCIt != FW->common_call_end()) {
-            CommonCall *CC = *CCIt;
-            auto *Callee = CC->getCalledFunction();
-
-            if (FunctionMap.count(Callee)) {
-                if (WithEdgeLabels) {
-                    Value *CI = CC->getInstruction();
-                    std::string S;
-                    raw_string_ostream RSO(S);
-                    if (CI != nullptr) {
-                        RSO << *(CI);
-                    } else {
-                        RSO << "Hidden";
-                    }
-                    std::string &EdgeLabelStr = RSO.str();
-                    for (char &C: EdgeLabelStr) {
-                        if (C == '\"') {
-                            C = '`';
-                        }
-
-                        if (C == '\n') {
-                            C = ' ';
-                        }
-                    }
-                    fprintf(FOut, "\tf%p->f%p[label=\"%s\"]\n", FW, FunctionMap[Callee],
-                            EdgeLabelStr.data());
-                } else {
-                    fprintf(FOut, "\tf%p->f%p\n", FW, FunctionMap[Callee]);
-                }
-            } else {
-                llvm_unreachable("ERROR in printCG when print common function calls.");
+    // the dependencies between sccs
+    unsigned NumSCCs = getNumSCCs();
+    std::vector<std::vector<unsigned>> Callers(NumSCCs);
+    std::vector<unsigned> LastCaller(NumSCCs, ~0U);
+    NumSCCCallees.assign(NumSCCs, 0);
+    for (unsigned SCCID = 0; SCCID < NumSCCs; ++SCCID) {
+        for (auto *N: getSCC(SCCID)) {
+            for (auto It = N->child_begin(), E = N->child_end(); It != E; ++It) {
+                unsigned CalleeSCC = NodeSCCs[(*It)->getID()];
+                if (CalleeSCC == SCCID || LastCaller[CalleeSCC] == SCCID) continue;
+                LastCaller[CalleeSCC] = SCCID;
+                Callers[CalleeSCC].push_back(SCCID);
+                NumSCCCallees[SCCID]++;
             }
-            CCIt++;
         }
+    }
+    SCCCallers.clear();
+    SCCCallerOffsets.clear();
+    for (auto &SCCCallerVec: Callers) {
+        SCCCallerOffsets.push_back(SCCCallers.size());
+        SCCCallers.insert(SCCCallers.end(), SCCCallerVec.begin(), SCCCallerVec.end());
+    }
+    SCCCallerOffsets.push_back(SCCCallers.size());
 
-        auto FPIt = FW->pointer_call_begin();
-        while (FPIt != FW->pointer_call_end()) {
-            PointerCall *PC = *FPIt;
-            char *EdgeLabelData = nullptr;
+    // the reachable sccs of an scc are the union of those of its callees
+    SCCReachable.assign(NumSCCs, SparseBitVector<>());
+    forEachSCCBottomUp([this](unsigned SCCID) {
+        SparseBitVector<> &Reachable = SCCReachable[SCCID];
+        for (auto *N: getSCC(SCCID)) {
+            for (auto It = N->child_begin(), E = N->child_end(); It != E; ++It) {
+                unsigned CalleeSCC = NodeSCCs[(*It)->getID()];
+                if (CalleeSCC != SCCID && !Reachable.test(CalleeSCC)) Reachable |= SCCReachable[CalleeSCC];
+                Reachable.set(CalleeSCC);
+            }
+        }
+    });
+}
+
+bool DyckCallGraph::mayReach(Function *Caller, Function *Callee) const {
+    auto *CallerNode = getFunction(Caller);
+    auto *CalleeNode = getFunction(Callee);
+    if (!CallerNode || !CalleeNode) return false;
+    return SCCReachable[getSCCID(CallerNode)].test(getSCCID(CalleeNode));
+}
+
+BitVector DyckCallGraph::getReachableNodes(ArrayRef<Function *> Entries) const {
+    BitVector ReachableSCCs(getNumSCCs());
+    for (auto *Entry: Entries) {
+        if (auto *N = getFunction(Entry)) {
+            unsigned SCCID = getSCCID(N);
+            for (unsigned CalleeSCC: SCCReachable[SCCID]) ReachableSCCs.set(CalleeSCC);
+            ReachableSCCs.set(SCCID);
+        }
+    }
+
+    BitVector Ret(Nodes.size());
+    for (unsigned SCCID: ReachableSCCs.set_bits())
+        for (auto *N: getSCC(SCCID)) Ret.set(N->getID());
+    return Ret;
+}
+
+void DyckCallGraph::forEachSCCBottomUp(const std::function<void(unsigned)> &Func) const {
+    unsigned NumSCCs = getNumSCCs();
+    // without workers, the bottom-up order is just the order of scc ids
+    if (ThreadPool::get()->numWorkers() == 0) {
+        for (unsigned SCCID = 0; SCCID < NumSCCs; ++SCCID) Func(SCCID);
+        return;
+    }
+
+    std::unique_ptr<std::atomic<unsigned>[]> Pending(new std::atomic<unsigned>[NumSCCs]);
+    for (unsigned SCCID = 0; SCCID < NumSCCs; ++SCCID) Pending[SCCID] = NumSCCCallees[SCCID];
+
+    // a task enqueues its callers that become ready before it finishes, so wait() sees them
+    std::function<void(unsigned)> Run = [&](unsigned SCCID) {
+        Func(SCCID);
+        for (unsigned K = SCCCallerOffsets[SCCID]; K < SCCCallerOffsets[SCCID + 1]; ++K) {
+            unsigned Caller = SCCCallers[K];
+            if (--Pending[Caller] == 0) ThreadPool::get()->enqueue(Run, Caller);
+        }
+    };
+    for (unsigned SCCID = 0; SCCID < NumSCCs; ++SCCID)
+        if (NumSCCCallees[SCCID] == 0) ThreadPool::get()->enqueue(Run, SCCID);
+    ThreadPool::get()->wait();
+}
+
+static StringRef getNodeName(const DyckCallGraphNode *N) {
+    auto *F = const_cast<DyckCallGraphNode *>(N)->getLLVMFunction();
+    return F ? F->getName() : "<external>";
+}
+
+/// number the instructions of \p F in order, so that a call site is referred to by (function id, ordinal)
+static void numberInstructions(Function *F, DenseMap<const Instruction *, unsigned> &Ordinals) {
+    Ordinals.clear();
+    if (!F) return;
+    unsigned Ordinal = 0;
+    for (auto &I: instructions(F)) Ordinals[&I] = Ordinal++;
+}
+
+void DyckCallGraph::exportCallGraph(raw_ostream &OS) const {
+    unsigned long NumEdges = 0;
+    for (auto *N: Nodes) NumEdges += N->child_edge_end() - N->child_edge_begin();
+
+    OS << "canary-callgraph 1\n" << Nodes.size() << " " << NumEdges << "\n";
+    for (auto *N: Nodes) OS << "n " << N->getID() << " " << getNodeName(N) << "\n";
+
+    DenseMap<const Instruction *, unsigned> Ordinals;
+    for (auto *N: Nodes) {
+        numberInstructions(N->getLLVMFunction(), Ordinals);
+        for (auto It = N->child_edge_begin(), E = N->child_edge_end(); It != E; ++It) {
+            auto *Inst = It->first ? It->first->getInstruction() : nullptr;
+            OS << "e " << N->getID() << " ";
+            if (Inst) OS << Ordinals.lookup(Inst);
+            else OS << "-1";
+            OS << " " << It->second->getID() << "\n";
+        }
+    }
+}
+
+void DyckCallGraph::dotCallGraph(const std::string &ModuleIdentifier) const {
+    std::error_code EC;
+    raw_fd_ostream OS(ModuleIdentifier + ".maycg.dot", EC);
+    OS << "digraph maycg {\n";
+    for (auto *N: Nodes) OS << "\tf" << N->getID() << "[label=\"" << getNodeName(N) << "\"]\n";
+
+    // edges are labeled by the ordinals of their call sites, see -dyck-callgraph-focus for the instructions
+    DenseMap<const Instruction *, unsigned> Ordinals;
+    for (auto *N: Nodes) {
+        if (WithEdgeLabels) numberInstructions(N->getLLVMFunction(), Ordinals);
+        for (auto It = N->child_edge_begin(), E = N->child_edge_end(); It != E; ++It) {
+            OS << "\tf" << N->getID() << "->f" << It->second->getID();
             if (WithEdgeLabels) {
-                std::string S;
-                raw_string_ostream RSO(S);
-                if (PC->getInstruction()) {
-                    RSO << *(PC->getInstruction());
-                } else {
-                    RSO << "Hidden";
-                }
-                std::string &EdgeLabelStr = RSO.str(); // edge label is the call inst
-                for (char &C: EdgeLabelStr) {
-                    if (C == '\"') {
-                        C = '`';
-                    }
-
-                    if (C == '\n') {
-                        C = ' ';
-                    }
-                }
-                EdgeLabelData = const_cast<char *> (EdgeLabelStr.data());
+                auto *Inst = It->first ? It->first->getInstruction() : nullptr;
+                if (Inst) OS << "[label=\"#" << Ordinals.lookup(Inst) << "\"]";
+                else OS << "[label=\"Hidden\"]";
             }
-            auto MCIt = PC->begin();
-            while (MCIt != PC->end()) {
-                Function *MCF = *MCIt;
-                if (FunctionMap.count(MCF)) {
-                    if (WithEdgeLabels) {
-                        fprintf(FOut, "\tf%p->f%p[label=\"%s\"]\n", FW, FunctionMap[MCF], EdgeLabelData);
-                    } else {
-                        fprintf(FOut, "\tf%p->f%p\n", FW, FunctionMap[MCF]);
-                    }
+            OS << "\n";
+        }
+    }
+    OS << "}\n";
+}
+
+void DyckCallGraph::dotCallGraphFocus(const std::string &FileName, Function *Focus, unsigned Depth) const {
+    auto *FocusNode = getFunction(Focus);
+    if (!FocusNode) {
+        errs() << "Function " << Focus->getName() << " is not in the call graph!\n";
+        return;
+    }
+
+    // the nodes within Depth calls from or to the focus
+    std::vector<std::vector<unsigned>> CallerIDs(Nodes.size());
+    for (auto *N: Nodes)
+        for (auto It = N->child_begin(), E = N->child_end(); It != E; ++It)
+            CallerIDs[(*It)->getID()].push_back(N->getID());
+    BitVector InFocus(Nodes.size());
+    for (bool Forward: {true, false}) {
+        std::vector<unsigned> Frontier = {FocusNode->getID()};
+        BitVector Visited(Nodes.size());
+        Visited.set(FocusNode->getID());
+        for (unsigned Level = 0; Level < Depth && !Frontier.empty(); ++Level) {
+            std::vector<unsigned> Next;
+            for (unsigned ID: Frontier) {
+                auto Visit = [&](unsigned Other) {
+                    if (Visited.test(Other)) return;
+                    Visited.set(Other);
+                    Next.push_back(Other);
+                };
+                if (Forward) {
+                    for (auto It = Nodes[ID]->child_begin(), E = Nodes[ID]->child_end(); It != E; ++It)
+                        Visit((*It)->getID());
                 } else {
-                    llvm_unreachable("ERROR in printCG when print fp calls.");
+                    for (unsigned Caller: CallerIDs[ID]) Visit(Caller);
                 }
-                MCIt++;
             }
-            FPIt++;
+            Frontier = std::move(Next);
         }
-        FWIt++;
+        InFocus |= Visited;
     }
 
-    fprintf(FOut, "}\n");
-    fclose(FOut);
+    std::error_code EC;
+    raw_fd_ostream OS(FileName, EC);
+    OS << "digraph maycg {\n";
+    for (unsigned ID: InFocus.set_bits()) {
+        OS << "\tf" << ID << "[label=\"" << getNodeName(Nodes[ID]) << "\"";
+        if (ID == FocusNode->getID()) OS << ", style=filled";
+        OS << "]\n";
+    }
+
+    // only the inspected edges are labeled by their call instructions
+    ModuleSlotTracker MST(Focus->getParent());
+    for (unsigned ID: InFocus.set_bits()) {
+        auto *N = Nodes[ID];
+        for (auto It = N->child_edge_begin(), E = N->child_edge_end(); It != E; ++It) {
+            if (!InFocus.test(It->second->getID())) continue;
+            std::string Label = "Hidden";
+            if (auto *Inst = It->first ? It->first->getInstruction() : nullptr) {
+                Label.clear();
+                raw_string_ostream LabelOS(Label);
+                Inst->print(LabelOS, MST);
+                LabelOS.flush();
+                std::replace(Label.begin(), Label.end(), '\"', '`');
+                std::replace(Label.begin(), Label.end(), '\n', ' ');
+            }
+            OS << "\tf" << ID << "->f" << It->second->getID() << "[label=\"" << Label << "\"]\n";
+        }
+    }
+    OS << "}\n";
 }
 
 void DyckCallGraph::printFunctionPointersInformation(const std::string &ModuleIdentifier) {
@@ -164,9 +336,9 @@ void DyckCallGraph::printFunctionPointersInformation(const std::string &ModuleId
 
     FILE *FOut = fopen(Dotfilename.data(), "w+");
 
-    auto FWIt = this->begin();
-    while (FWIt != this->end()) {
-        DyckCallGraphNode *FW = FWIt->second;
+    auto FWIt = Nodes.begin();
+    while (FWIt != Nodes.end()) {
+        DyckCallGraphNode *FW = *FWIt;
 
         auto FPIt = FW->pointer_call_begin();
         while (FPIt != FW->pointer_call_end()) {
@@ -18,48 +18,32 @@
 
 #include "DyckAA/DyckCallGraphNode.h"
 
-static int GlobalCallID = 0;
-
-Call::Call(CallKind K, Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args) : Kind(K) {
+Call::Call(CallKind K, Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args, int ID) : Kind(K) {
     assert(CalledValue != nullptr && "Error when create a call: called value is null!");
     assert(Args != nullptr && "Error when create a call: args is null!");
 
     this->CalledValue = CalledValue;
     this->Inst = Inst;
     this->Args = *Args;
-    this->CallId = ++GlobalCallID;
+    this->CallId = ID;
 }
 
-CommonCall::CommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args)
-        : Call(CK_Common, Inst, Func, Args) {
+CommonCall::CommonCall(Instruction *Inst, Function *Func, std::vector<Value *> *Args, int ID)
+        : Call(CK_Common, Inst, Func, Args, ID) {
 }
 
-PointerCall::PointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args)
-        : Call(CK_Pointer, Inst, CalledValue, Args) {
+PointerCall::PointerCall(Instruction *Inst, Value *CalledValue, std::vector<Value *> *Args, int ID)
+        : Call(CK_Pointer, Inst, CalledValue, Args, ID) {
 }
 
-DyckCallGraphNode::DyckCallGraphNode(Function *F) : Func(F) {
+DyckCallGraphNode::DyckCallGraphNode(Function *F, unsigned ID) : Func(F), ID(ID) {
     if (!F) return;
     for (unsigned K = 0; K < F->arg_size(); ++K) Args.push_back(F->getArg(K));
 }
 
-DyckCallGraphNode::~DyckCallGraphNode() {
-    auto It = PointerCalls.begin();
-    while (It != PointerCalls.end()) {
-        delete (*It);
-        It++;
-    }
-
-    auto CIt = CommonCalls.begin();
-    while (CIt != CommonCalls.end()) {
-        delete *CIt;
-        CIt++;
-    }
-}
-
 void DyckCallGraphNode::addPointerCall(PointerCall *PC) {
     InstructionCallMap.insert(std::pair<Instruction *, Call *>(PC->getInstruction(), PC));
-    PointerCalls.insert(PC);
+    PointerCalls.push_back(PC);
 }
 
 Function *DyckCallGraphNode::getLLVMFunction() {
@@ -68,7 +52,7 @@ Function *DyckCallGraphNode::getLLVMFunction() {
 
 void DyckCallGraphNode::addCommonCall(CommonCall *CC) {
     InstructionCallMap.insert(std::pair<Instruction *, Call *>(CC->getInstruction(), CC));
-    CommonCalls.insert(CC);
+    CommonCalls.push_back(CC);
 }
 
 void DyckCallGraphNode::addRet(Value *Ret) {
@@ -96,7 +80,5 @@ std::set<Value *> &DyckCallGraphNode::getReturns() {
 }
 
 Call *DyckCallGraphNode::getCall(Instruction *Inst) {
-    auto It = InstructionCallMap.find(Inst);
-    if (It != InstructionCallMap.end()) return It->second;
-    return nullptr;
+    return InstructionCallMap.lookup(Inst);
 }
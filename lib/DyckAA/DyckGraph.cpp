@@ -190,7 +190,7 @@ DyckGraphNode *DyckGraph::combine(DyckGraphNode *NodeX, DyckGraphNode *NodeY) {
     return NodeX;
 }
 
-bool DyckGraph::qirunAlgorithm() {
+bool DyckGraph::qirunAlgorithm(const std::chrono::steady_clock::time_point *Deadline) {
     bool Ret = true;
     std::multimap<DyckGraphNode *, void *> Worklist;
     auto VIt = Vertices.begin();
@@ -208,7 +208,10 @@ bool DyckGraph::qirunAlgorithm() {
 
     if (!Worklist.empty()) Ret = false;
 
+    unsigned long Steps = 0;
     while (!Worklist.empty()) {
+        // checking the clock is not free, so we only do it every 1024 combinations
+        if (Deadline && (++Steps & 1023) == 0 && std::chrono::steady_clock::now() >= *Deadline) break;
         //outs()<<"HERE0\n"; outs().flush();
         auto ZIt = Worklist.begin();
         //outs()<<"HERE0.1\n"; outs().flush();
@@ -354,24 +357,15 @@ void DyckGraph::validation(const char *File, int Line) {
 }
 
 void DyckGraph::getReachableVertices(const std::set<DyckGraphNode *> &Sources, std::set<DyckGraphNode *> &Reachable) {
+    // nodes already in Reachable have been expanded by previous calls
     std::stack<DyckGraphNode *> WorkStack;
-    for (auto *N: Sources) if (N) WorkStack.push(N);
-    std::set<DyckGraphNode *> Visited;
+    for (auto *N: Sources) if (N && Reachable.insert(N).second) WorkStack.push(N);
     while (!WorkStack.empty()) {
         DyckGraphNode *Top = WorkStack.top();
         WorkStack.pop();
-        if (Visited.count(Top)) continue;
-        Visited.insert(Top);
-
-        std::set<DyckGraphNode *> Tars;
-        Top->getOutVertices(&Tars);
-        auto TIt = Tars.begin();
-        while (TIt != Tars.end()) {
-            DyckGraphNode *DGN = (*TIt);
-            if (Visited.find(DGN) == Visited.end())
-                WorkStack.push(DGN);
-            TIt++;
-        }
+        for (auto &LabelTargets: Top->getOutVertices())
+            for (auto *DGN: LabelTargets.second)
+                if (Reachable.insert(DGN).second) WorkStack.push(DGN);
     }
 }
 
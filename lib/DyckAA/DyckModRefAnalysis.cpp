@@ -16,11 +16,20 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include "DyckAA/AliasQueryProfiler.h"
 #include "DyckAA/DyckAliasAnalysis.h"
 #include "DyckAA/DyckModRefAnalysis.h"
 #include "MRAnalyzer.h"
 #include "Support/RecursiveTimer.h"
 
+#define DEBUG_TYPE "DyckModRefAnalysis"
+
+static cl::opt<bool> CheckCallSiteModRef("check-dyck-modref", cl::init(false), cl::Hidden,
+                                         cl::desc("Check the mod/refs of call sites against those "
+                                                  "collected from all transitive callees."));
+
 char DyckModRefAnalysis::ID = 0;
 static RegisterPass<DyckModRefAnalysis> X("dyckmr", "m/r based on the unification based alias analysis");
 
@@ -36,10 +45,154 @@ void DyckModRefAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 
 bool DyckModRefAnalysis::runOnModule(Module &M) {
     RecursiveTimer DyckMRA("Running DyckMRA");
-    auto *DyckAA = &getAnalysis<DyckAliasAnalysis>();
-    MRAnalyzer MR(&M, DyckAA->getDyckGraph(), DyckAA->getDyckCallGraph());
+    AliasQueryProfiler::ClientScope Client("DyckModRefAnalysis");
+    DAA = &getAnalysis<DyckAliasAnalysis>();
+    MRAnalyzer MR(&M, DAA);
     MR.intraProcedureAnalysis();
     MR.interProcedureAnalysis();
     MR.swap(Func2MR); // get the result
+
+    std::set<DyckGraphNode *> Globals, Reachable;
+    for (auto &G: M.global_values())
+        if (auto *N = DAA->getDyckGraph()->findDyckVertex(&G)) Globals.insert(N);
+    DAA->getDyckGraph()->getReachableVertices(Globals, Reachable);
+    for (auto *N: Reachable) GlobalClasses.set(DAA->getAliasClassID(N));
+
+    if (CheckCallSiteModRef) checkCallSiteModRefs(M);
     return false;
 }
+
+ModRefInfo DyckModRefAnalysis::getAttributeModRefInfo(const CallBase *Call, const Function *F) {
+    if (Call->doesNotAccessMemory() || (F && F->doesNotAccessMemory())) return ModRefInfo::NoModRef;
+    if (Call->onlyReadsMemory() || (F && F->onlyReadsMemory())) return ModRefInfo::Ref;
+    return ModRefInfo::ModRef;
+}
+
+const DyckModRefAnalysis::CallSiteModRef &DyckModRefAnalysis::getCallSiteModRef(const CallInst *CI) {
+    std::lock_guard<std::mutex> Lock(CallSiteCacheMutex);
+    auto It = CallSiteCache.find(CI);
+    if (It != CallSiteCache.end()) return It->second;
+
+    auto &Ret = CallSiteCache[CI];
+    auto *CallerNode = DAA->getDyckCallGraph()->getFunction(const_cast<Function *>(CI->getFunction()));
+    auto *TheCall = CallerNode ? CallerNode->getCall(const_cast<CallInst *>(CI)) : nullptr;
+    auto AddCallee = [this, CI, &Ret](Function *Callee) {
+        if (Callee->empty() || !Func2MR.count(Callee)) {
+            Ret.Any = unionModRef(Ret.Any, getAttributeModRefInfo(CI, Callee));
+            return;
+        }
+        auto &CalleeMR = Func2MR.at(Callee);
+        Ret.MR.Mods |= CalleeMR.Mods;
+        Ret.MR.Refs |= CalleeMR.Refs;
+        Ret.Global = unionModRef(Ret.Global, getAttributeModRefInfo(CI, Callee));
+    };
+    if (auto *CC = dyn_cast_or_null<CommonCall>(TheCall)) {
+        if (auto *Callee = CC->getCalledFunction()) AddCallee(Callee);
+        else Ret.Any = getAttributeModRefInfo(CI, nullptr);
+    } else if (auto *PC = dyn_cast_or_null<PointerCall>(TheCall)) {
+        for (auto *Callee: *PC) AddCallee(Callee);
+        if (PC->empty()) Ret.Any = getAttributeModRefInfo(CI, nullptr);
+    } else {
+        // calls that are not in the call graph, e.g., intrinsics and inline asm
+        Ret.Any = getAttributeModRefInfo(CI, CI->getCalledFunction());
+    }
+    return Ret;
+}
+
+ModRefInfo DyckModRefAnalysis::getModRefInfo(const CallInst *Call, const Value *Ptr) {
+    auto &CSMR = getCallSiteModRef(Call);
+    unsigned MemID = DAA->pointsTo(Ptr);
+    if (MemID == DyckAliasAnalysis::InvalidClassID) return ModRefInfo::ModRef;
+    // the analysis cannot track where the pointer comes from, e.g., returns of unmodeled external functions
+    if (DAA->isOpaqueComponent(DAA->getOffsetComponent(DAA->getAliasClassID(Ptr)))) return ModRefInfo::ModRef;
+
+    ModRefInfo Ret = CSMR.Any;
+    if (GlobalClasses.test(MemID)) Ret = unionModRef(Ret, CSMR.Global);
+    if (CSMR.MR.Mods.test(MemID)) Ret = setMod(Ret);
+    if (CSMR.MR.Refs.test(MemID)) Ret = setRef(Ret);
+    return Ret;
+}
+
+void DyckModRefAnalysis::checkCallSiteModRefs(Module &M) {
+    auto *DG = DAA->getDyckGraph();
+    auto *DCG = DAA->getDyckCallGraph();
+    // the memory that a function accesses by itself, no matter whether its callers can see it.
+    // functions without bodies access what is reachable from their arguments, by their attributes
+    auto GetMemory = [this](Value *Ptr) { return Ptr ? DAA->pointsTo(Ptr) : DyckAliasAnalysis::InvalidClassID; };
+    std::vector<ModRef> Local(DCG->size());
+    for (auto It = DCG->nodes_begin(), E = DCG->nodes_end(); It != E; ++It) {
+        auto *F = (*It)->getLLVMFunction();
+        if (!F || F->empty()) continue;
+        auto &MR = Local[(*It)->getID()];
+        for (auto &I: instructions(F)) {
+            Value *RefPtr = nullptr, *ModPtr = nullptr;
+            if (auto *LI = dyn_cast<LoadInst>(&I)) {
+                RefPtr = LI->getPointerOperand();
+            } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+                ModPtr = SI->getPointerOperand();
+            } else if (auto *MI = dyn_cast<MemIntrinsic>(&I)) {
+                ModPtr = MI->getRawDest();
+                if (auto *MTI = dyn_cast<MemTransferInst>(MI)) RefPtr = MTI->getRawSource();
+            } else if (auto *CI = dyn_cast<CallInst>(&I)) {
+                auto *Callee = CI->getCalledFunction();
+                if (!Callee || !Callee->empty() || Callee->isIntrinsic()) continue;
+                auto Effect = getAttributeModRefInfo(CI, Callee);
+                std::set<DyckGraphNode *> Sources, Accessible;
+                for (auto &Arg: CI->args()) {
+                    unsigned MemID = GetMemory(Arg.get());
+                    if (MemID != DyckAliasAnalysis::InvalidClassID) Sources.insert(DAA->getAliasClassNode(MemID));
+                }
+                DG->getReachableVertices(Sources, Accessible);
+                for (auto *N: Accessible) {
+                    if (isModSet(Effect)) MR.Mods.set(DAA->getAliasClassID(N));
+                    if (isRefSet(Effect)) MR.Refs.set(DAA->getAliasClassID(N));
+                }
+            }
+            if (GetMemory(RefPtr) != DyckAliasAnalysis::InvalidClassID) MR.Refs.set(GetMemory(RefPtr));
+            if (GetMemory(ModPtr) != DyckAliasAnalysis::InvalidClassID) MR.Mods.set(GetMemory(ModPtr));
+        }
+    }
+
+    // each load/store after a direct call in the same function is checked against all transitive callees
+    unsigned long NumQueries = 0, NumMissed = 0;
+    for (auto &F: M) {
+        for (auto &I: instructions(F)) {
+            auto *CI = dyn_cast<CallInst>(&I);
+            auto *Callee = CI ? CI->getCalledFunction() : nullptr;
+            if (!Callee || Callee->empty()) continue;
+            ModRef Expected;
+            for (unsigned NodeID: DCG->getReachableNodes(Callee).set_bits()) {
+                Expected.Mods |= Local[NodeID].Mods;
+                Expected.Refs |= Local[NodeID].Refs;
+            }
+            if (Callee->onlyReadsMemory()) Expected.Mods.clear();
+
+            // the caller sees the memory reachable from the arguments, the return and the globals
+            std::set<DyckGraphNode *> Sources, Visible;
+            for (auto &Arg: CI->args())
+                if (auto *N = DG->findDyckVertex(Arg.get())) Sources.insert(N);
+            if (auto *N = DG->findDyckVertex(CI)) Sources.insert(N);
+            DG->getReachableVertices(Sources, Visible);
+
+            for (auto &J: instructions(F)) {
+                Value *Ptr = nullptr;
+                if (auto *LI = dyn_cast<LoadInst>(&J)) Ptr = LI->getPointerOperand();
+                else if (auto *SI = dyn_cast<StoreInst>(&J)) Ptr = SI->getPointerOperand();
+                unsigned MemID = GetMemory(Ptr);
+                if (MemID == DyckAliasAnalysis::InvalidClassID) continue;
+                // an untracked pointer may point to any memory that a callee accesses
+                bool Opaque = DAA->isOpaqueComponent(DAA->getOffsetComponent(DAA->getAliasClassID(Ptr)));
+                if (!Opaque && !GlobalClasses.test(MemID) && !Visible.count(DAA->getAliasClassNode(MemID))) continue;
+                auto Result = getModRefInfo(CI, Ptr);
+                ++NumQueries;
+                bool ExpectMod = Opaque ? !Expected.Mods.empty() : Expected.Mods.test(MemID);
+                bool ExpectRef = Opaque ? !Expected.Refs.empty() : Expected.Refs.test(MemID);
+                if ((ExpectMod && !isModSet(Result)) || (ExpectRef && !isRefSet(Result))) {
+                    ++NumMissed;
+                    LLVM_DEBUG(dbgs() << "Missed mod/ref of " << *CI << " on " << *Ptr << "\n");
+                }
+            }
+        }
+    }
+    outs() << "Checked " << NumQueries << " call site mod/ref queries, " << NumMissed << " missed.\n";
+}
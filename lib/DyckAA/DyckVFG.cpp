@@ -18,7 +18,10 @@
 
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
+#include <algorithm>
+#include "DyckAA/AliasQueryProfiler.h"
 #include "DyckAA/DyckAliasAnalysis.h"
+#include "DyckAA/DyckCallGraph.h"
 #include "DyckAA/DyckGraph.h"
 #include "DyckAA/DyckGraphNode.h"
 #include "DyckAA/DyckModRefAnalysis.h"
@@ -28,81 +31,170 @@
 #include "Support/ThreadPool.h"
 
 DyckVFG::DyckVFG(DyckAliasAnalysis *DAA, DyckModRefAnalysis *DMRA, Module *M) {
-    // create a VFG for each function
+    AliasQueryProfiler::ClientScope Client("DyckVFG");
+    auto *DyckCG = DAA->getDyckCallGraph();
+
+    // create all entries first, so that each task only writes to the entries of its own function
     std::map<Function *, CFGRef> LocalCFGMap;
+    FunctionMemoryAccessesTy FunctionMemoryAccesses;
+    std::map<Function *, std::vector<VFGEdge>> FunctionEdges;
     for (auto &F: *M) {
         if (F.empty()) continue;
         LocalCFGMap[&F] = nullptr;
-        buildLocalVFG(F);
+        FunctionMemoryAccesses[&F];
+        FunctionEdges[&F];
     }
 
+    // index the loads and stores of each function by the accessed memory, the call nodes depend on them
     for (auto &F: *M) {
         if (F.empty()) continue;
-        ThreadPool::get()->enqueue([this, DAA, &F, &LocalCFGMap](){
+        ThreadPool::get()->enqueue([DAA, DMRA, &F, &FunctionMemoryAccesses]() {
+            auto &Accesses = FunctionMemoryAccesses.at(&F);
+            for (auto &I: instructions(F)) {
+                if (auto *Load = dyn_cast<LoadInst>(&I)) {
+                    unsigned MemID = DAA->pointsTo(Load->getPointerOperand());
+                    if (MemID != DyckAliasAnalysis::InvalidClassID) Accesses.Loads[MemID].push_back(Load);
+                } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+                    unsigned MemID = DAA->pointsTo(Store->getPointerOperand());
+                    if (MemID != DyckAliasAnalysis::InvalidClassID) Accesses.Stores[MemID].push_back(Store);
+                }
+            }
+            // the summaries are much wider than the accesses, so they are intersected once per function
+            if (!DMRA->count(&F)) return;
+            auto LoadIt = Accesses.Loads.begin(), LoadE = Accesses.Loads.end();
+            for (auto It = DMRA->ref_begin(&F), E = DMRA->ref_end(&F); It != E && LoadIt != LoadE; ++It) {
+                while (LoadIt != LoadE && LoadIt->first < *It) ++LoadIt;
+                if (LoadIt != LoadE && LoadIt->first == *It) Accesses.Inputs.push_back(*It);
+            }
+            auto StoreIt = Accesses.Stores.begin(), StoreE = Accesses.Stores.end();
+            for (auto It = DMRA->mod_begin(&F), E = DMRA->mod_end(&F); It != E && StoreIt != StoreE; ++It) {
+                while (StoreIt != StoreE && StoreIt->first < *It) ++StoreIt;
+                if (StoreIt != StoreE && StoreIt->first == *It) Accesses.Outputs.push_back(*It);
+            }
+        });
+    }
+    ThreadPool::get()->wait();
+
+    // nodes are shared among functions, e.g., those of constants and globals, so they are all
+    // created first. afterwards, the node map is read-only and functions are handled in parallel
+    for (auto &F: *M) {
+        if (F.empty()) continue;
+        createVFGNodes(F);
+        forEachCallee(DyckCG, F, [this, &FunctionMemoryAccesses](Call *C, Function *Callee) {
+            createVFGNodes(FunctionMemoryAccesses, C, Callee);
+        });
+    }
+    Nodes.shrink_to_fit();
+
+    // build the local VFG of each function
+    for (auto &F: *M) {
+        if (F.empty()) continue;
+        ThreadPool::get()->enqueue([this, DAA, &F, &LocalCFGMap, &FunctionEdges]() {
             auto LocalCFG = std::make_shared<CFG>(&F);
             LocalCFGMap.at(&F) = LocalCFG;
-            buildLocalVFG(DAA, LocalCFG.get(), &F);
+            auto &Edges = FunctionEdges.at(&F);
+            buildLocalVFG(F, Edges);
+            buildLocalVFG(DAA, LocalCFG.get(), &F, Edges);
         });
     }
     ThreadPool::get()->wait();
 
-    // connect local VFGs
-    auto *DyckCG = DAA->getDyckCallGraph();
+    // connect local VFGs in parallel over the callers, edges of a call are put in the caller's buffer
     for (auto &F: *M) {
         if (F.empty()) continue;
-        auto *CtrlFlow = LocalCFGMap.at(&F).get();
-        auto *CGNode = DyckCG->getFunction(&F);
-        if (!CGNode) continue;
-        for (auto &I: instructions(F)) {
-            auto *CI = dyn_cast<CallInst>(&I);
-            if (!CI) continue;
-            auto *TheCall = CGNode->getCall(CI);
-            if (auto *CC = dyn_cast_or_null<CommonCall>(TheCall)) {
-                auto *Callee = dyn_cast<Function>(CC->getCalledFunction());
-                assert(Callee);
+        ThreadPool::get()->enqueue([this, DMRA, DyckCG, &F, &LocalCFGMap, &FunctionMemoryAccesses, &FunctionEdges]() {
+            auto *CtrlFlow = LocalCFGMap.at(&F).get();
+            auto &Edges = FunctionEdges.at(&F);
+            forEachCallee(DyckCG, F, [&](Call *C, Function *Callee) {
+                connect(DMRA, FunctionMemoryAccesses, C, Callee, CtrlFlow, Edges);
+            });
+        });
+    }
+    ThreadPool::get()->wait();
+
+    // merge the buffers, the result does not depend on scheduling as the edges are sorted when frozen
+    std::vector<VFGEdge> Edges;
+    size_t NumEdges = 0;
+    for (auto &It: FunctionEdges) NumEdges += It.second.size();
+    Edges.reserve(NumEdges);
+    for (auto &It: FunctionEdges) {
+        Edges.insert(Edges.end(), It.second.begin(), It.second.end());
+        std::vector<VFGEdge>().swap(It.second);
+    }
+    freeze(Edges);
+}
+
+void DyckVFG::freeze(std::vector<VFGEdge> &Edges) {
+    std::sort(Edges.begin(), Edges.end(), [](const VFGEdge &A, const VFGEdge &B) {
+        if (A.From->ID != B.From->ID) return A.From->ID < B.From->ID;
+        if (A.To->ID != B.To->ID) return A.To->ID < B.To->ID;
+        return A.Label < B.Label;
+    });
+    Edges.erase(std::unique(Edges.begin(), Edges.end(), [](const VFGEdge &A, const VFGEdge &B) {
+        return A.From == B.From && A.To == B.To && A.Label == B.Label;
+    }), Edges.end());
+
+    // edges of node K are [Offsets[K], Offsets[K + 1]) in the csr arrays
+    std::vector<unsigned> TargetOffsets(Nodes.size() + 1, 0), SourceOffsets(Nodes.size() + 1, 0);
+    for (auto &E: Edges) {
+        TargetOffsets[E.From->ID + 1]++;
+        SourceOffsets[E.To->ID + 1]++;
+    }
+    for (unsigned K = 0; K < Nodes.size(); ++K) {
+        TargetOffsets[K + 1] += TargetOffsets[K];
+        SourceOffsets[K + 1] += SourceOffsets[K];
+    }
+
+    // the edges are sorted by the sources, so the in edges of each node are also sorted by the sources
+    Targets.resize(Edges.size());
+    Sources.resize(Edges.size());
+    std::vector<unsigned> SourcePos(SourceOffsets.begin(), SourceOffsets.end() - 1);
+    for (unsigned K = 0; K < Edges.size(); ++K) {
+        auto &E = Edges[K];
+        Targets[K] = {E.To, E.Label};
+        Sources[SourcePos[E.To->ID]++] = {E.From, E.Label};
+    }
+    for (auto &N: Nodes) {
+        N.TargetsBegin = Targets.data() + TargetOffsets[N.ID];
+        N.TargetsEnd = Targets.data() + TargetOffsets[N.ID + 1];
+        N.SourcesBegin = Sources.data() + SourceOffsets[N.ID];
+        N.SourcesEnd = Sources.data() + SourceOffsets[N.ID + 1];
+    }
+}
+
+void DyckVFG::forEachCallee(DyckCallGraph *DyckCG, Function &F, const std::function<void(Call *, Function *)> &Func) {
+    auto *CGNode = DyckCG->getFunction(&F);
+    if (!CGNode) return;
+    for (auto &I: instructions(F)) {
+        auto *CI = dyn_cast<CallInst>(&I);
+        if (!CI) continue;
+        auto *TheCall = CGNode->getCall(CI);
+        if (auto *CC = dyn_cast_or_null<CommonCall>(TheCall)) {
+            auto *Callee = dyn_cast<Function>(CC->getCalledFunction());
+            assert(Callee);
+            if (Callee->empty()) continue;
+            Func(TheCall, Callee);
+        } else if (auto *PC = dyn_cast_or_null<PointerCall>(TheCall)) {
+            for (Function *Callee: *PC) {
                 if (Callee->empty()) continue;
-                connect(DMRA, TheCall, Callee, CtrlFlow);
-            } else if (auto *PC = dyn_cast_or_null<PointerCall>(TheCall)) {
-                for (Function *Callee: *PC) {
-                    if (Callee->empty()) continue;
-                    connect(DMRA, TheCall, Callee, CtrlFlow);
-                }
+                Func(TheCall, Callee);
             }
         }
     }
 }
 
-void DyckVFG::buildLocalVFG(Function &F) {
-    // direct value flow through cast, gep-0-0, select, phi
+void DyckVFG::createVFGNodes(Function &F) {
     for (auto &I: instructions(F)) {
         if (isa<CastInst>(I) || isa<PHINode>(I)) {
-            auto *ToNode = getOrCreateVFGNode(&I);
-            for (unsigned K = 0; K < I.getNumOperands(); ++K) {
-                auto *From = I.getOperand(K);
-                auto *FromNode = getOrCreateVFGNode(From);
-                FromNode->addTarget(ToNode);
-            }
+            getOrCreateVFGNode(&I);
+            for (unsigned K = 0; K < I.getNumOperands(); ++K) getOrCreateVFGNode(I.getOperand(K));
         } else if (isa<SelectInst>(I)) {
-            auto *ToNode = getOrCreateVFGNode(&I);
-            for (unsigned K = 1; K < I.getNumOperands(); ++K) {
-                auto *From = I.getOperand(K);
-                auto *FromNode = getOrCreateVFGNode(From);
-                FromNode->addTarget(ToNode);
-            }
+            getOrCreateVFGNode(&I);
+            for (unsigned K = 1; K < I.getNumOperands(); ++K) getOrCreateVFGNode(I.getOperand(K));
         } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
-            bool VF = true;
-            for (auto &Index: GEP->indices()) {
-                if (auto *CI = dyn_cast<ConstantInt>(&Index)) {
-                    if (CI->getSExtValue() != 0) {
-                        VF = false;
-                        break;
-                    }
-                }
-            }
-            if (VF) {
-                auto *ToNode = getOrCreateVFGNode(&I);
-                auto *FromNode = getOrCreateVFGNode(GEP->getPointerOperand());
-                FromNode->addTarget(ToNode);
+            if (isZeroGEP(GEP)) {
+                getOrCreateVFGNode(&I);
+                getOrCreateVFGNode(GEP->getPointerOperand());
             }
         } else if (isa<LoadInst>(I)) {
             getOrCreateVFGNode(&I);
@@ -114,7 +206,66 @@ void DyckVFG::buildLocalVFG(Function &F) {
     }
 }
 
-void DyckVFG::buildLocalVFG(DyckAliasAnalysis *DAA, CFG *CtrlFlow, Function *F) const {
+void DyckVFG::createVFGNodes(const FunctionMemoryAccessesTy &FunctionMemoryAccesses, Call *C, Function *Callee) {
+    for (unsigned K = 0; K < C->numArgs(); ++K) {
+        if (K >= Callee->arg_size()) continue; // ignore var args
+        getOrCreateVFGNode(C->getArg(K));
+        getOrCreateVFGNode(Callee->getArg(K));
+    }
+    if (!C->getInstruction()->getType()->isVoidTy()) {
+        getOrCreateVFGNode(C->getInstruction());
+        for (auto &Inst: instructions(Callee)) {
+            auto *RetInst = dyn_cast<ReturnInst>(&Inst);
+            if (!RetInst) continue;
+            if (RetInst->getNumOperands() != 1) continue;
+            getOrCreateVFGNode(Inst.getOperand(0));
+        }
+    }
+
+    // one node per class that may flow into or out of the callee through memory, see connect
+    auto *Caller = C->getInstruction()->getFunction();
+    if (Caller == Callee) return;
+    auto &CallerAccesses = FunctionMemoryAccesses.at(Caller);
+    auto &CalleeAccesses = FunctionMemoryAccesses.at(Callee);
+    for (unsigned MemID: CalleeAccesses.Inputs) {
+        if (!CallerAccesses.Stores.count(MemID) || CallInputNodes.count({C, MemID})) continue;
+        CallInputNodes[{C, MemID}] = Nodes.size();
+        Nodes.emplace_back(nullptr, Nodes.size());
+    }
+    for (unsigned MemID: CalleeAccesses.Outputs) {
+        if (!CallerAccesses.Loads.count(MemID) || CallOutputNodes.count({C, MemID})) continue;
+        CallOutputNodes[{C, MemID}] = Nodes.size();
+        Nodes.emplace_back(nullptr, Nodes.size());
+    }
+}
+
+bool DyckVFG::isZeroGEP(GetElementPtrInst *GEP) {
+    for (auto &Index: GEP->indices()) {
+        if (auto *CI = dyn_cast<ConstantInt>(&Index)) {
+            if (CI->getSExtValue() != 0) return false;
+        }
+    }
+    return true;
+}
+
+void DyckVFG::buildLocalVFG(Function &F, std::vector<VFGEdge> &Edges) const {
+    // direct value flow through cast, gep-0-0, select, phi
+    for (auto &I: instructions(F)) {
+        if (isa<CastInst>(I) || isa<PHINode>(I)) {
+            auto *ToNode = getVFGNode(&I);
+            for (unsigned K = 0; K < I.getNumOperands(); ++K)
+                Edges.push_back({getVFGNode(I.getOperand(K)), ToNode, 0});
+        } else if (isa<SelectInst>(I)) {
+            auto *ToNode = getVFGNode(&I);
+            for (unsigned K = 1; K < I.getNumOperands(); ++K)
+                Edges.push_back({getVFGNode(I.getOperand(K)), ToNode, 0});
+        } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+            if (isZeroGEP(GEP)) Edges.push_back({getVFGNode(GEP->getPointerOperand()), getVFGNode(&I), 0});
+        }
+    }
+}
+
+void DyckVFG::buildLocalVFG(DyckAliasAnalysis *DAA, CFG *CtrlFlow, Function *F, std::vector<VFGEdge> &Edges) const {
     // indirect value flow through load/store
     auto *DG = DAA->getDyckGraph();
     std::map<DyckGraphNode *, std::vector<LoadInst *>> LoadMap; // ptr -> load
@@ -145,95 +296,82 @@ void DyckVFG::buildLocalVFG(DyckAliasAnalysis *DAA, CFG *CtrlFlow, Function *F)
                 if (CtrlFlow->reachable(Store, Load)) {
                     auto *StNode = getVFGNode(Store->getValueOperand());
                     assert(StNode);
-                    StNode->addTarget(LdNode);
+                    Edges.push_back({StNode, LdNode, 0});
                 }
             }
         }
     }
 }
 
-DyckVFG::~DyckVFG() {
-    for (auto &It: ValueNodeMap) delete It.second;
-}
+DyckVFG::~DyckVFG() = default;
 
 DyckVFGNode *DyckVFG::getVFGNode(Value *V) const {
     auto It = ValueNodeMap.find(V);
     if (It == ValueNodeMap.end()) return nullptr;
-    return It->second;
+    return getNode(It->second);
 }
 
 DyckVFGNode *DyckVFG::getOrCreateVFGNode(Value *V) {
     auto It = ValueNodeMap.find(V);
-    if (It == ValueNodeMap.end()) {
-        auto *Ret = new DyckVFGNode(V);
-        ValueNodeMap[V] = Ret;
-        return Ret;
-    }
-    return It->second;
+    if (It != ValueNodeMap.end()) return &Nodes[It->second];
+    unsigned ID = Nodes.size();
+    ValueNodeMap[V] = ID;
+    Nodes.emplace_back(V, ID);
+    return &Nodes.back();
 }
 
-static void collectValues(std::set<DyckGraphNode *>::iterator Begin, std::set<DyckGraphNode *>::iterator End,
-                          std::set<Value *> &CallerVals, std::set<Value *> &CalleeVals, Call *C, Function *Callee,
-                          CFG *Ctrl) {
-    auto *Caller = C->getInstruction()->getFunction();
-    for (auto It = Begin; It != End; ++It) {
-        auto *N = *It;
-        auto *ValSet = (std::set<Value *> *) N->getEquivalentSet();
-        for (auto *V: *ValSet) {
-            if (auto *Arg = dyn_cast<Argument>(V)) {
-                if (Arg->getParent() == Callee) CalleeVals.insert(Arg);
-                else if (Arg->getParent() == Caller) CallerVals.insert(Arg);
-            } else if (auto *Inst = dyn_cast<Instruction>(V)) {
-                if (Inst->getFunction() == Callee) CalleeVals.insert(Inst);
-                else if (Inst->getFunction() == Caller && Ctrl->reachable(Inst, C->getInstruction()))
-                    CallerVals.insert(Inst);
-            }
-        }
-    }
-}
-
-void DyckVFG::connect(DyckModRefAnalysis *DMRA, Call *C, Function *Callee, CFG *Ctrl) {
+void DyckVFG::connect(DyckModRefAnalysis *DMRA, const FunctionMemoryAccessesTy &FunctionMemoryAccesses, Call *C,
+                      Function *Callee, CFG *Ctrl, std::vector<VFGEdge> &Edges) const {
     // connect direct inputs
     for (unsigned K = 0; K < C->numArgs(); ++K) {
         if (K >= Callee->arg_size()) continue; // ignore var args
-        auto *Actual = C->getArg(K);
-        auto *ActualNode = getOrCreateVFGNode(Actual);
-        auto *Formal = Callee->getArg(K);
-        auto *FormalNode = getOrCreateVFGNode(Formal);
-        ActualNode->addTarget(FormalNode, C->id());
+        auto *ActualNode = getVFGNode(C->getArg(K));
+        auto *FormalNode = getVFGNode(Callee->getArg(K));
+        Edges.push_back({ActualNode, FormalNode, C->id()});
     }
     // connect direct outputs
     if (!C->getInstruction()->getType()->isVoidTy()) {
-        auto *ActualRet = getOrCreateVFGNode(C->getInstruction());
+        auto *ActualRet = getVFGNode(C->getInstruction());
         for (auto &Inst: instructions(Callee)) {
             auto *RetInst = dyn_cast<ReturnInst>(&Inst);
             if (!RetInst) continue;
             if (RetInst->getNumOperands() != 1) continue;
-            auto *FormalRet = getOrCreateVFGNode(Inst.getOperand(0));
-            FormalRet->addTarget(ActualRet, -C->id());
+            Edges.push_back({getVFGNode(Inst.getOperand(0)), ActualRet, -C->id()});
         }
     }
 
     // this callee does not contain mod/refs except for formal parameters/rets
     if (!DMRA->count(Callee)) return;
 
-    // connect indirect inputs
-    //  1. get refs, get ref values (in caller, C is reachable from these values, and callee)
-    //  2. connect ref values (caller) -> ref values (callee)
-    std::set<Value *> RefCallerValues, RefCalleeValues;
-    collectValues(DMRA->ref_begin(Callee), DMRA->ref_end(Callee), RefCallerValues, RefCalleeValues, C, Callee, Ctrl);
-    for (auto *CallerVal: RefCallerValues)
-        for (auto *CalleeVal: RefCalleeValues)
-            getOrCreateVFGNode(CallerVal)->addTarget(getOrCreateVFGNode(CalleeVal), C->id());
-
-    // connect indirect outputs
-    //  1. get mods, get mod values (in caller and callee)
-    //  2. connect ref values (callee) -> ref values (caller)
-    std::set<Value *> ModCallerValues, ModCalleeValues;
-    collectValues(DMRA->mod_begin(Callee), DMRA->mod_end(Callee), ModCallerValues, ModCalleeValues, C, Callee, Ctrl);
-    for (auto *CalleeVal: ModCalleeValues)
-        for (auto *CallerVal: ModCallerValues)
-            getOrCreateVFGNode(CalleeVal)->addTarget(getOrCreateVFGNode(CallerVal), -C->id());
+    // connect indirect inputs and outputs via the memory the callee refs and mods, i.e.,
+    //  stores in the caller before C -> loads in the callee, labeled as a call
+    //  stores in the callee -> loads in the caller after C, labeled as a return
+    // the stores and the loads of a class meet at the node of (C, class), instead of a cross product of edges
+    auto *Caller = C->getInstruction()->getFunction();
+    if (Caller == Callee) return;
+    auto &CallerAccesses = FunctionMemoryAccesses.at(Caller);
+    auto &CalleeAccesses = FunctionMemoryAccesses.at(Callee);
+    for (unsigned MemID: CalleeAccesses.Inputs) {
+        auto StoreIt = CallerAccesses.Stores.find(MemID);
+        if (StoreIt == CallerAccesses.Stores.end()) continue;
+        auto *InNode = getNode(CallInputNodes.at({C, MemID}));
+        for (auto *Store: StoreIt->second) {
+            if (!Ctrl->reachable(Store, C->getInstruction())) continue;
+            Edges.push_back({getVFGNode(Store->getValueOperand()), InNode, C->id()});
+        }
+        for (auto *Load: CalleeAccesses.Loads.at(MemID)) Edges.push_back({InNode, getVFGNode(Load), 0});
+    }
+    for (unsigned MemID: CalleeAccesses.Outputs) {
+        auto LoadIt = CallerAccesses.Loads.find(MemID);
+        if (LoadIt == CallerAccesses.Loads.end()) continue;
+        auto *OutNode = getNode(CallOutputNodes.at({C, MemID}));
+        for (auto *Store: CalleeAccesses.Stores.at(MemID))
+            Edges.push_back({getVFGNode(Store->getValueOperand()), OutNode, 0});
+        for (auto *Load: LoadIt->second) {
+            if (!Ctrl->reachable(C->getInstruction(), Load)) continue;
+            Edges.push_back({OutNode, getVFGNode(Load), -C->id()});
+        }
+    }
 }
 
 Function *DyckVFGNode::getFunction() const {
@@ -19,66 +19,179 @@
 #include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include "DyckAA/AliasQueryProfiler.h"
 #include "MRAnalyzer.h"
+#include "Support/ThreadPool.h"
 
-MRAnalyzer::MRAnalyzer(Module *M, DyckGraph *DG, DyckCallGraph *DCG) : M(M), DG(DG), DCG(DCG) {
+MRAnalyzer::MRAnalyzer(Module *M, DyckAliasAnalysis *DAA)
+        : M(M), DAA(DAA), DG(DAA->getDyckGraph()), DCG(DAA->getDyckCallGraph()) {
 }
 
 MRAnalyzer::~MRAnalyzer() = default;
 
 void MRAnalyzer::intraProcedureAnalysis() {
+    AliasQueryProfiler::ClientScope Client("MRAnalyzer");
+    buildClassGraph();
 
+    // create all entries first, so that functions can be analyzed in parallel
+    VisibleClasses.resize(DCG->size());
+    std::vector<std::vector<unsigned>> NodeSources(DCG->size());
+    for (auto It = DCG->nodes_begin(), E = DCG->nodes_end(); It != E; ++It) {
+        auto *F = (*It)->getLLVMFunction();
+        if (!F) continue; // there is one and only one fake node that does not include a function
+        Func2MR[F];
+        auto &Sources = NodeSources[(*It)->getID()];
+        collectSources(F, Sources);
+        for (unsigned ID: Sources) ReachableClasses[ID];
+    }
+
+    // functions whose parameters/returns are in the same classes share the traversals
+    for (auto &It: ReachableClasses) {
+        ThreadPool::get()->enqueue([this, &It]() { collectReachableClasses(It.first, It.second); });
+    }
+    ThreadPool::get()->wait();
+
+    for (auto It = DCG->nodes_begin(), E = DCG->nodes_end(); It != E; ++It) {
+        auto *F = (*It)->getLLVMFunction();
+        if (!F) continue;
+        ThreadPool::get()->enqueue([this, F, &NodeSources](unsigned ID) {
+            auto &Visible = VisibleClasses[ID];
+            auto &Sources = NodeSources[ID];
+            for (unsigned SrcID: Sources) Visible |= ReachableClasses.at(SrcID);
+            runOnFunction(F, Visible);
+        }, (*It)->getID());
+    }
+    ThreadPool::get()->wait();
 }
 
 void MRAnalyzer::interProcedureAnalysis() {
-    // fixme let's impl a simple version where we do not use scc and bottom-up inter-proc analysis
-    for (auto It = DCG->nodes_begin(), E = DCG->nodes_end(); It != E; ++It)
-        runOnFunction(*It);
+    AliasQueryProfiler::ClientScope Client("MRAnalyzer");
+    DCG->forEachSCCBottomUp([this](unsigned SCCID) { runOnSCC(DCG->getSCC(SCCID)); });
+}
+
+void MRAnalyzer::runOnSCC(ArrayRef<DyckCallGraphNode *> SCC) {
+    // a function also mod/refs what its callees mod/ref, if the caller's callers can see it.
+    // callees outside the scc are done, those inside the scc are iterated to a fixed point
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        for (auto *CGNode: SCC) {
+            auto *F = CGNode->getLLVMFunction();
+            if (!F) continue;
+            auto &Visible = VisibleClasses[CGNode->getID()];
+            auto &MR = Func2MR.at(F);
+            for (auto It = CGNode->child_begin(), E = CGNode->child_end(); It != E; ++It) {
+                auto *Callee = (*It)->getLLVMFunction();
+                if (!Callee || Callee == F) continue;
+                auto &CalleeMR = Func2MR.at(Callee);
+                if (MR.Refs |= CalleeMR.Refs & Visible) Changed = true;
+                if (F->onlyReadsMemory()) continue;
+                if (MR.Mods |= CalleeMR.Mods & Visible) Changed = true;
+            }
+        }
+        // a single function without recursion needs no more iterations
+        if (SCC.size() == 1) break;
+    }
 }
 
-void MRAnalyzer::runOnFunction(DyckCallGraphNode *CGNode) {
-    auto *F = CGNode->getLLVMFunction();
-    if (!F) return; // there is one and only one fake node that does not include a function
+void MRAnalyzer::buildClassGraph() {
+    unsigned NumClasses = DAA->getNumAliasClasses();
+    ClassSuccOffsets.reserve(NumClasses + 1);
+    for (unsigned ID = 0; ID < NumClasses; ++ID) {
+        ClassSuccOffsets.push_back(ClassSuccs.size());
+        for (auto &LabelTargets: DAA->getAliasClassNode(ID)->getOutVertices())
+            for (auto *Target: LabelTargets.second) ClassSuccs.push_back(DAA->getAliasClassID(Target));
+    }
+    ClassSuccOffsets.push_back(ClassSuccs.size());
+}
 
-    auto &MR = Func2MR[F];
-    std::set<DyckGraphNode *> &Refs = MR.Mods;
-    std::set<DyckGraphNode *> &Mods = MR.Refs;
+void MRAnalyzer::collectSources(Function *F, std::vector<unsigned> &Sources) const {
+    auto AddSource = [this, &Sources](Value *V) {
+        unsigned ID = DAA->getAliasClassID(V);
+        if (ID != DyckAliasAnalysis::InvalidClassID) Sources.push_back(ID);
+    };
+    for (unsigned K = 0; K < F->arg_size(); ++K) AddSource(F->getArg(K));
+    for (auto &I: instructions(F))
+        if (auto *Ret = dyn_cast<ReturnInst>(&I))
+            if (auto *RetVal = Ret->getReturnValue()) AddSource(RetVal);
+    std::sort(Sources.begin(), Sources.end());
+    Sources.erase(std::unique(Sources.begin(), Sources.end()), Sources.end());
+}
 
-    // compute a set of dyck nodes reachable from parameters and todo returns
-    std::set<DyckGraphNode *> ParReachableNodes;
-    std::set<DyckGraphNode *> RetReachableNodes;
-    for (unsigned K = 0; K < F->arg_size(); ++K) {
-        auto *DGNode = DG->findDyckVertex(F->getArg(K));
-        if (!DGNode) continue;
-        DG->getReachableVertices(DGNode, ParReachableNodes);
+void MRAnalyzer::collectReachableClasses(unsigned Source, SparseBitVector<> &Reachable) const {
+    std::vector<unsigned> WorkList;
+    Reachable.set(Source);
+    WorkList.push_back(Source);
+    while (!WorkList.empty()) {
+        unsigned ID = WorkList.back();
+        WorkList.pop_back();
+        for (unsigned K = ClassSuccOffsets[ID]; K < ClassSuccOffsets[ID + 1]; ++K) {
+            if (Reachable.test_and_set(ClassSuccs[K])) WorkList.push_back(ClassSuccs[K]);
+        }
     }
-    for (unsigned K = 0; K < F->arg_size(); ++K) {
-        auto *DGNode = DG->findDyckVertex(F->getArg(K));
-        if (!DGNode) continue;
-        ParReachableNodes.erase(DGNode); // let us exclude explicit parameters
+}
+
+ModRefInfo MRAnalyzer::getExternalModRefInfo(DyckCallGraphNode *CGNode, CallInst *CI) const {
+    if (isa<DbgInfoIntrinsic>(CI) || CI->isLifetimeStartOrEnd()) return ModRefInfo::NoModRef;
+    auto *C = CGNode->getCall(CI);
+    if (auto *CC = dyn_cast_or_null<CommonCall>(C)) {
+        auto *Callee = CC->getCalledFunction();
+        if (Callee && !Callee->empty()) return ModRefInfo::NoModRef;
+        return DyckModRefAnalysis::getAttributeModRefInfo(CI, Callee);
+    } else if (auto *PC = dyn_cast_or_null<PointerCall>(C)) {
+        if (PC->empty()) return DyckModRefAnalysis::getAttributeModRefInfo(CI, nullptr);
+        ModRefInfo Ret = ModRefInfo::NoModRef;
+        for (auto *Callee: *PC)
+            if (Callee->empty()) Ret = unionModRef(Ret, DyckModRefAnalysis::getAttributeModRefInfo(CI, Callee));
+        return Ret;
     }
+    // calls that are not in the call graph, e.g., intrinsics and inline asm
+    return DyckModRefAnalysis::getAttributeModRefInfo(CI, CI->getCalledFunction());
+}
 
-    // for each instruction,
-    // if it refs a node that is reachable from parameters add it to refs
-    // if it mods a node that is reachable from parameters add it to mods
+void MRAnalyzer::runOnFunction(Function *F, const SparseBitVector<> &Visible) {
+    auto &MR = Func2MR.at(F);
+    auto *CGNode = DCG->getFunction(F);
+    // the class of the memory pointed to by Ptr, if it is visible to the callers
+    auto GetVisibleMemory = [this, &Visible](Value *Ptr) -> unsigned {
+        if (!Ptr) return DyckAliasAnalysis::InvalidClassID;
+        unsigned MemID = DAA->pointsTo(Ptr);
+        if (MemID != DyckAliasAnalysis::InvalidClassID && Visible.test(MemID)) return MemID;
+        return DyckAliasAnalysis::InvalidClassID;
+    };
+
+    bool ReadOnly = F->onlyReadsMemory();
     for (auto &I: instructions(F)) {
-        for (unsigned K = 0; K < I.getNumOperands(); ++K) {
-            auto *Ref = I.getOperand(K);
-            auto *RefNode = DG->findDyckVertex(Ref);
-            if (!RefNode) continue;
-            // check if reachable from parameters
-            if (ParReachableNodes.count(RefNode)) Refs.insert(RefNode);
-        }
-        if (F->onlyReadsMemory()) continue; // a read only function
-        if (auto *SI = dyn_cast<StoreInst>(&I)) {
-            auto *Ptr = SI->getPointerOperand();
-            auto *PtrNode = DG->findDyckVertex(Ptr);
-            if (!PtrNode) continue;
-            auto *ModNode = PtrNode->getOutVertex(DG->getDereferenceEdgeLabel());
-            // check if reachable from parameters and returns
-            if (ParReachableNodes.count(ModNode) || RetReachableNodes.count(ModNode)) Mods.insert(ModNode);
-        } else {
-            // todo other instructions that may revise a memory
+        Value *RefPtr = nullptr, *ModPtr = nullptr;
+        if (auto *LI = dyn_cast<LoadInst>(&I)) {
+            RefPtr = LI->getPointerOperand();
+        } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+            ModPtr = SI->getPointerOperand();
+        } else if (auto *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+            RefPtr = ModPtr = RMW->getPointerOperand();
+        } else if (auto *CmpXchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+            RefPtr = ModPtr = CmpXchg->getPointerOperand();
+        } else if (auto *MI = dyn_cast<MemIntrinsic>(&I)) {
+            ModPtr = MI->getRawDest();
+            if (auto *MTI = dyn_cast<MemTransferInst>(MI)) RefPtr = MTI->getRawSource();
+        } else if (auto *CI = dyn_cast<CallInst>(&I)) {
+            // an external callee may access any memory reachable from the arguments
+            ModRefInfo External = getExternalModRefInfo(CGNode, CI);
+            if (External == ModRefInfo::NoModRef) continue;
+            for (auto &Arg: CI->args()) {
+                unsigned MemID = DAA->pointsTo(Arg.get());
+                if (MemID == DyckAliasAnalysis::InvalidClassID) continue;
+                SparseBitVector<> Accessible;
+                collectReachableClasses(MemID, Accessible);
+                Accessible &= Visible;
+                if (isRefSet(External)) MR.Refs |= Accessible;
+                if (!ReadOnly && isModSet(External)) MR.Mods |= Accessible;
+            }
         }
+        unsigned RefID = GetVisibleMemory(RefPtr);
+        if (RefID != DyckAliasAnalysis::InvalidClassID) MR.Refs.set(RefID);
+        unsigned ModID = GetVisibleMemory(ModPtr);
+        if (!ReadOnly && ModID != DyckAliasAnalysis::InvalidClassID) MR.Mods.set(ModID);
     }
 }
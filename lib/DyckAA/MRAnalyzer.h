@@ -22,6 +22,7 @@
 #include <llvm/IR/Module.h>
 #include <llvm/Support/CommandLine.h>
 
+#include "DyckAA/DyckAliasAnalysis.h"
 #include "DyckAA/DyckCallGraph.h"
 #include "DyckAA/DyckGraph.h"
 #include "DyckAA/DyckModRefAnalysis.h"
@@ -31,12 +32,26 @@ using namespace llvm;
 class MRAnalyzer {
 private:
     Module *M;
+    DyckAliasAnalysis *DAA;
     DyckGraph *DG;
     DyckCallGraph *DCG;
     std::map<Function *, ModRef> Func2MR;
 
+    /// the alias graph over class ids,
+    /// successors of class K are ClassSuccs[ClassSuccOffsets[K], ClassSuccOffsets[K + 1])
+    /// @{
+    std::vector<unsigned> ClassSuccs;
+    std::vector<unsigned> ClassSuccOffsets;
+    /// @}
+
+    /// the classes reachable from a class that holds some parameters or returns, shared by the functions
+    std::map<unsigned, SparseBitVector<>> ReachableClasses;
+
+    /// the classes visible to the callers of each call graph node, indexed by the node id
+    std::vector<SparseBitVector<>> VisibleClasses;
+
 public:
-    MRAnalyzer(Module *, DyckGraph *, DyckCallGraph *);
+    MRAnalyzer(Module *, DyckAliasAnalysis *);
 
     ~MRAnalyzer();
 
@@ -47,7 +62,22 @@ public:
     void swap(std::map<Function *, ModRef> &Result) { Result.swap(Func2MR); }
 
 private:
-    void runOnFunction(DyckCallGraphNode *);
+    /// propagate the mod/refs of the callees to the functions in an scc, whose callees outside the scc are done
+    void runOnSCC(ArrayRef<DyckCallGraphNode *> SCC);
+
+    void buildClassGraph();
+
+    /// collect the classes of the parameters and returns of \p F, i.e., where its callers can see its effects from
+    void collectSources(Function *F, std::vector<unsigned> &Sources) const;
+
+    /// collect the classes reachable from \p Source via any edges, including \p Source
+    void collectReachableClasses(unsigned Source, SparseBitVector<> &Reachable) const;
+
+    /// the effects of the functions without bodies that \p CI may call, by their attributes
+    ModRefInfo getExternalModRefInfo(DyckCallGraphNode *CGNode, CallInst *CI) const;
+
+    /// compute the mod/refs of \p F by its own instructions and its calls to functions without bodies
+    void runOnFunction(Function *F, const SparseBitVector<> &Visible);
 };
 
 #endif //DYCKAA_MRANALYZER_H
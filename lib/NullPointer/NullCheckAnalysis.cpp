@@ -16,7 +16,9 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Module.h>
+#include "DyckAA/AliasQueryProfiler.h"
 #include "NullPointer/LocalNullCheckAnalysis.h"
 #include "NullPointer/NullCheckAnalysis.h"
 #include "NullPointer/NullFlowAnalysis.h"
@@ -25,6 +27,9 @@
 
 static cl::opt<unsigned> Round("nca-round", cl::init(2), cl::Hidden, cl::desc("# rounds"));
 
+static cl::opt<bool> PrintStats("print-nca-stats", cl::init(false), cl::Hidden,
+                                cl::desc("Print how many dereferenced pointers are proven to be not null"));
+
 char NullCheckAnalysis::ID = 0;
 static RegisterPass<NullCheckAnalysis> X("nca", "soundly checking if a pointer may be nullptr.");
 
@@ -41,6 +46,7 @@ void NullCheckAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 bool NullCheckAnalysis::runOnModule(Module &M) {
     // record time
     RecursiveTimer TR("Running NullCheckAnalysis");
+    AliasQueryProfiler::ClientScope Client("NullCheckAnalysis");
 
     // get the null flow analysis
     auto *NFA = &getAnalysis<NullFlowAnalysis>();
@@ -64,6 +70,20 @@ bool NullCheckAnalysis::runOnModule(Module &M) {
         Funcs.clear();
     } while (Count++ < Round.getValue() && NFA->recompute(Funcs));
 
+    if (PrintStats.getValue()) {
+        unsigned NumDerefs = 0, NumNotNullFlows = 0, NumNotNull = 0;
+        for (auto &F: M) {
+            for (auto &I: instructions(&F)) {
+                auto *Ptr = getLoadStorePointerOperand(&I);
+                if (!Ptr) continue;
+                ++NumDerefs;
+                if (NFA->notNull(Ptr)) ++NumNotNullFlows;
+                if (!mayNull(Ptr, &I)) ++NumNotNull;
+            }
+        }
+        outs() << "# deref pointers: " << NumDerefs << ", # not-null by NFA: " << NumNotNullFlows
+               << ", # not-null by NCA: " << NumNotNull << ".\n";
+    }
     return false;
 }
 
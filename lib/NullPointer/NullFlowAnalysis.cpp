@@ -17,6 +17,7 @@
  */
 
 #include <llvm/IR/InstIterator.h>
+#include "DyckAA/AliasQueryProfiler.h"
 #include "DyckAA/DyckAliasAnalysis.h"
 #include "DyckAA/DyckValueFlowAnalysis.h"
 #include "NullPointer/NullFlowAnalysis.h"
@@ -42,6 +43,7 @@ void NullFlowAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 
 bool NullFlowAnalysis::runOnModule(Module &M) {
     RecursiveTimer DyckVFA("Running NFA");
+    AliasQueryProfiler::ClientScope Client("NullFlowAnalysis");
     auto *VFA = &getAnalysis<DyckValueFlowAnalysis>();
     VFG = VFA->getDyckVFGraph();
     DAA = &getAnalysis<DyckAliasAnalysis>();
@@ -88,9 +90,11 @@ bool NullFlowAnalysis::runOnModule(Module &M) {
         for (auto &T: *Top) if (!Visited.count(T.first)) DFSStack.push_back(T.first);
     }
 
-    // get initial non null nodes
-    set_intersection(Visited.begin(), Visited.end(), VFG->node_begin(), VFG->node_end(),
-                     inserter(NonNullNodes, NonNullNodes.begin()));
+    // get initial non null nodes, i.e., those not reachable from any may-null node
+    for (unsigned ID = 0; ID < VFG->getNumNodes(); ++ID) {
+        auto *N = VFG->getNode(ID);
+        if (!Visited.count(N)) NonNullNodes.insert(N);
+    }
     return false;
 }
 
@@ -38,6 +38,9 @@ void (*before_thread_start_hook)() = nullptr;
 void (*after_thread_complete_hook)() = nullptr;
 /// @}
 
+void *(*ThreadPool::CaptureHook)() = nullptr;
+void *(*ThreadPool::SwitchHook)(void *) = nullptr;
+
 ThreadPool *ThreadPool::get() {
     if (!Threads)
         Threads = new ThreadPool;
@@ -0,0 +1,72 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/IR/InstIterator.h>
+#include "Support/ValueKey.h"
+
+ValueKey::ValueKey(Module &M) : M(M) {
+    for (auto &F: M) {
+        if (F.empty()) continue;
+        auto &Insts = Instructions[&F];
+        for (auto &I: instructions(F)) {
+            Ordinals[&I] = Insts.size();
+            Insts.push_back(&I);
+        }
+    }
+}
+
+std::string ValueKey::get(const Value *V) const {
+    if (auto *GV = dyn_cast<GlobalValue>(V)) {
+        if (!GV->hasName()) return "";
+        return "@" + GV->getName().str();
+    } else if (auto *Arg = dyn_cast<Argument>(V)) {
+        return Arg->getParent()->getName().str() + ":a" + std::to_string(Arg->getArgNo());
+    } else if (auto *Inst = dyn_cast<Instruction>(V)) {
+        auto It = Ordinals.find(Inst);
+        if (It == Ordinals.end()) return "";
+        return Inst->getFunction()->getName().str() + ":" + std::to_string(It->second);
+    }
+    return "";
+}
+
+Value *ValueKey::resolve(StringRef Key, Instruction **Context) const {
+    if (Context) *Context = nullptr;
+    if (Key.empty()) return nullptr;
+    if (Key.front() == '@') return M.getNamedValue(Key.drop_front());
+
+    SmallVector<StringRef, 3> Parts;
+    Key.split(Parts, ':');
+    if (Parts.size() < 2 || Parts.size() > 3) return nullptr;
+    auto *F = M.getFunction(Parts[0]);
+    if (!F) return nullptr;
+
+    unsigned N;
+    if (Parts.size() == 2 && Parts[1].startswith("a")) {
+        if (Parts[1].drop_front().getAsInteger(10, N) || N >= F->arg_size()) return nullptr;
+        return F->getArg(N);
+    }
+    auto It = Instructions.find(F);
+    if (It == Instructions.end() || Parts[1].getAsInteger(10, N) || N >= It->second.size()) return nullptr;
+    Instruction *Inst = It->second[N];
+    if (Context) *Context = Inst;
+    if (Parts.size() == 2) return Inst;
+
+    unsigned K;
+    if (Parts[2].getAsInteger(10, K) || K >= Inst->getNumOperands()) return nullptr;
+    return Inst->getOperand(K);
+}
@@ -0,0 +1,105 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+#include "DyckAA/AliasQueryProfiler.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+#include "Support/RecursiveTimer.h"
+#include "Transform/AliasScopeMetadata.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#define DEBUG_TYPE "AliasScopeMetadata"
+
+char AliasScopeMetadata::ID = 0;
+static RegisterPass<AliasScopeMetadata> X(DEBUG_TYPE, "Emitting scoped noalias metadata by dyck-aa");
+
+void AliasScopeMetadata::getAnalysisUsage(AnalysisUsage &AU) const {
+    // only metadata is attached, which no analysis here reads
+    AU.setPreservesAll();
+    AU.addRequired<DyckAliasAnalysis>();
+}
+
+bool AliasScopeMetadata::runOnModule(Module &M) {
+    RecursiveTimer Timer("Emitting alias scopes");
+    AliasQueryProfiler::ClientScope Client("AliasScopeMetadata");
+    auto *DAA = &getAnalysis<DyckAliasAnalysis>();
+    MDBuilder MDB(M.getContext());
+
+    // metadata are uniqued in the context, thus functions are not visited in parallel
+    unsigned NumFunctions = 0, NumScopes = 0, NumAccesses = 0;
+    for (auto &F: M) {
+        if (F.empty()) continue;
+
+        // group the loads and stores by the offset component of their pointers
+        std::map<unsigned, std::vector<Instruction *>> ComponentAccesses;
+        for (auto &I: instructions(F)) {
+            Value *Ptr = nullptr;
+            if (auto *LI = dyn_cast<LoadInst>(&I)) Ptr = LI->getPointerOperand();
+            else if (auto *SI = dyn_cast<StoreInst>(&I)) Ptr = SI->getPointerOperand();
+            else continue;
+            unsigned ID = DAA->getAliasClassID(Ptr);
+            if (ID == DyckAliasAnalysis::InvalidClassID) continue; // unknown pointers may alias anything
+            unsigned CompID = DAA->getOffsetComponent(ID);
+            if (DAA->isOpaqueComponent(CompID)) continue; // and so may pointers computed from integers
+            ComponentAccesses[CompID].push_back(&I);
+        }
+        // no pairs of accesses to separate
+        if (ComponentAccesses.size() < 2) continue;
+
+        // the components with the most accesses get the scopes, the others are left alone
+        std::vector<std::vector<Instruction *> *> Groups;
+        for (auto &It: ComponentAccesses) Groups.push_back(&It.second);
+        if (Groups.size() > MaxScopes) {
+            std::stable_sort(Groups.begin(), Groups.end(), [](std::vector<Instruction *> *A,
+                                                              std::vector<Instruction *> *B) {
+                return A->size() > B->size();
+            });
+            Groups.resize(MaxScopes);
+        }
+
+        auto *Domain = MDB.createAnonymousAliasScopeDomain(F.getName());
+        std::vector<Metadata *> Scopes;
+        for (unsigned K = 0; K < Groups.size(); ++K)
+            Scopes.push_back(MDB.createAnonymousAliasScope(Domain, F.getName().str() + ".c" + std::to_string(K)));
+
+        // an access is in its own scope, and does not alias the accesses in the other scopes
+        for (unsigned K = 0; K < Groups.size(); ++K) {
+            auto *Scope = MDNode::get(M.getContext(), Scopes[K]);
+            std::vector<Metadata *> Others(Scopes.begin(), Scopes.end());
+            Others.erase(Others.begin() + K);
+            auto *NoAlias = MDNode::get(M.getContext(), Others);
+            for (auto *I: *Groups[K]) {
+                I->setMetadata(LLVMContext::MD_alias_scope,
+                               MDNode::concatenate(I->getMetadata(LLVMContext::MD_alias_scope), Scope));
+                I->setMetadata(LLVMContext::MD_noalias,
+                               MDNode::concatenate(I->getMetadata(LLVMContext::MD_noalias), NoAlias));
+            }
+            NumAccesses += Groups[K]->size();
+        }
+        NumScopes += Groups.size();
+        NumFunctions++;
+    }
+    outs() << "Attached " << NumScopes << " alias scopes to " << NumAccesses << " loads/stores in " << NumFunctions
+           << " functions.\n";
+    return NumFunctions;
+}
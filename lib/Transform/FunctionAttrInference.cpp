@@ -0,0 +1,297 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/Analysis/CaptureTracking.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <functional>
+#include "DyckAA/AliasQueryProfiler.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+#include "Support/RecursiveTimer.h"
+#include "Transform/FunctionAttrInference.h"
+
+#define DEBUG_TYPE "FunctionAttrInference"
+
+char FunctionAttrInference::ID = 0;
+static RegisterPass<FunctionAttrInference> X(DEBUG_TYPE, "Inferring function attributes by dyck-aa");
+
+void FunctionAttrInference::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<DyckAliasAnalysis>();
+    // only attributes are changed, the values and the calls dyck-aa knows stay the same
+    AU.addPreserved<DyckAliasAnalysis>();
+}
+
+/// whether the function body is the one that will be executed, i.e., it cannot be replaced at link time
+static bool isAnalyzable(const Function *F) {
+    return F && !F->isDeclaration() && F->hasExactDefinition();
+}
+
+/// the effects of accessing the memory \p Ptr points to,
+/// objects on the stack of the function and reads of constant globals are ignored
+static unsigned getAccessEffects(const Value *Ptr, bool Reads, bool Writes) {
+    auto *Obj = getUnderlyingObject(Ptr);
+    if (isa<AllocaInst>(Obj)) return FunctionAttrInference::ME_None;
+    auto *GV = dyn_cast<GlobalVariable>(Obj);
+    if (GV && GV->isConstant()) Reads = false;
+    bool IsArg = isa<Argument>(Obj);
+    unsigned Ret = FunctionAttrInference::ME_None;
+    if (Reads) Ret |= IsArg ? FunctionAttrInference::ME_ReadArg : FunctionAttrInference::ME_ReadOther;
+    if (Writes) Ret |= IsArg ? FunctionAttrInference::ME_WriteArg : FunctionAttrInference::ME_WriteOther;
+    return Ret;
+}
+
+/// the effects of a call by the attributes of the call site and the callee
+static unsigned getAttributeEffects(const CallBase *CB, const Function *Callee) {
+    if (CB->doesNotAccessMemory() || (Callee && Callee->doesNotAccessMemory())) return FunctionAttrInference::ME_None;
+    unsigned Ret = FunctionAttrInference::ME_All;
+    if (CB->onlyAccessesArgMemory() || (Callee && Callee->onlyAccessesArgMemory()))
+        Ret &= FunctionAttrInference::ME_ReadArg | FunctionAttrInference::ME_WriteArg;
+    if (CB->onlyReadsMemory() || (Callee && Callee->onlyReadsMemory()))
+        Ret &= FunctionAttrInference::ME_ReadArg | FunctionAttrInference::ME_ReadOther;
+    return Ret;
+}
+
+namespace {
+/// a capture tracker that sees through the pointer calls resolved by dyck-aa
+class DyckCaptureTracker : public CaptureTracker {
+private:
+    std::function<bool(CallBase *, SmallVectorImpl<Function *> &)> GetCallees;
+    bool ReturnCaptures;
+
+public:
+    bool Captured = false;
+
+    DyckCaptureTracker(std::function<bool(CallBase *, SmallVectorImpl<Function *> &)> GetCallees,
+                       bool ReturnCaptures) : GetCallees(std::move(GetCallees)), ReturnCaptures(ReturnCaptures) {}
+
+    void tooManyUses() override { Captured = true; }
+
+    bool captured(const Use *U) override {
+        auto *I = cast<Instruction>(U->getUser());
+        if (isa<ReturnInst>(I) && !ReturnCaptures) return false;
+        // the callees that do not capture the argument, found after the call is resolved
+        auto *CB = dyn_cast<CallBase>(I);
+        if (CB && CB->isArgOperand(U)) {
+            unsigned ArgNo = CB->getArgOperandNo(U);
+            SmallVector<Function *, 4> Callees;
+            if (GetCallees(CB, Callees) && std::all_of(Callees.begin(), Callees.end(), [ArgNo](Function *Callee) {
+                return ArgNo < Callee->arg_size() && Callee->hasParamAttribute(ArgNo, Attribute::NoCapture);
+            }))
+                return false;
+        }
+        Captured = true;
+        return true;
+    }
+};
+} // namespace
+
+bool FunctionAttrInference::runOnModule(Module &M) {
+    RecursiveTimer Timer("Inferring function attributes");
+    AliasQueryProfiler::ClientScope Client("FunctionAttrInference");
+    DyckCG = getAnalysis<DyckAliasAnalysis>().getDyckCallGraph();
+
+    // sccs are visited bottom-up, so the attributes of the callees outside an scc are ready.
+    // attributes are uniqued in the context, thus sccs are not visited in parallel
+    unsigned NumReadNone = 0, NumReadOnly = 0, NumArgMemOnly = 0, NumNoCapture = 0, NumNoAlias = 0;
+    for (unsigned SCCID = 0; SCCID < DyckCG->getNumSCCs(); ++SCCID) {
+        auto SCC = DyckCG->getSCC(SCCID);
+        inferMemoryEffects(SCC);
+        for (auto *CGNode: SCC) {
+            auto *F = CGNode->getLLVMFunction();
+            if (!isAnalyzable(F)) continue;
+
+            unsigned E = Effects.at(F);
+            if (E == ME_None) {
+                if (!F->doesNotAccessMemory()) {
+                    // readnone is stronger than, and incompatible with, the other memory attributes
+                    F->removeFnAttr(Attribute::ReadOnly);
+                    F->removeFnAttr(Attribute::WriteOnly);
+                    F->removeFnAttr(Attribute::ArgMemOnly);
+                    F->removeFnAttr(Attribute::InaccessibleMemOnly);
+                    F->removeFnAttr(Attribute::InaccessibleMemOrArgMemOnly);
+                    F->setDoesNotAccessMemory();
+                    NumReadNone++;
+                }
+            } else {
+                if (!(E & (ME_WriteArg | ME_WriteOther)) && !F->onlyReadsMemory() &&
+                    !F->hasFnAttribute(Attribute::WriteOnly)) {
+                    F->setOnlyReadsMemory();
+                    NumReadOnly++;
+                }
+                if (!(E & (ME_ReadOther | ME_WriteOther)) && !F->onlyAccessesArgMemory() &&
+                    !F->onlyAccessesInaccessibleMemory() && !F->onlyAccessesInaccessibleMemOrArgMem()) {
+                    F->setOnlyAccessesArgMemory();
+                    NumArgMemOnly++;
+                }
+            }
+
+            for (auto &Arg: F->args()) {
+                if (!Arg.getType()->isPointerTy() || Arg.hasNoCaptureAttr()) continue;
+                if (mayCapture(&Arg, F, true)) continue;
+                Arg.addAttr(Attribute::NoCapture);
+                NumNoCapture++;
+            }
+
+            if (F->getReturnType()->isPointerTy() && !F->returnDoesNotAlias() && isMallocLike(F)) {
+                F->setReturnDoesNotAlias();
+                NumNoAlias++;
+            }
+        }
+    }
+
+    unsigned NumAttrs = NumReadNone + NumReadOnly + NumArgMemOnly + NumNoCapture + NumNoAlias;
+    outs() << "Inferred " << NumAttrs << " attributes: " << NumReadNone << " readnone, " << NumReadOnly
+           << " readonly, " << NumArgMemOnly << " argmemonly, " << NumNoCapture << " nocapture, " << NumNoAlias
+           << " noalias returns.\n";
+    return NumAttrs;
+}
+
+void FunctionAttrInference::inferMemoryEffects(ArrayRef<DyckCallGraphNode *> SCC) {
+    // start from no effects, the effects of the functions in an scc only grow
+    for (auto *CGNode: SCC) {
+        auto *F = CGNode->getLLVMFunction();
+        if (isAnalyzable(F)) Effects[F] = ME_None;
+    }
+
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        for (auto *CGNode: SCC) {
+            auto *F = CGNode->getLLVMFunction();
+            if (!isAnalyzable(F)) continue;
+            unsigned E = getMemoryEffects(F);
+            if (E == Effects.at(F)) continue;
+            Effects[F] = E;
+            Changed = true;
+        }
+    }
+}
+
+unsigned FunctionAttrInference::getMemoryEffects(Function *F) {
+    unsigned Ret = ME_None;
+    for (auto &I: instructions(F)) {
+        if (!I.mayReadOrWriteMemory()) continue;
+        if (auto *CB = dyn_cast<CallBase>(&I)) {
+            Ret |= getCallEffects(CB, F);
+            continue;
+        }
+
+        Value *Ptr = nullptr;
+        bool Volatile = false;
+        if (auto *LI = dyn_cast<LoadInst>(&I)) {
+            Ptr = LI->getPointerOperand();
+            Volatile = LI->isVolatile();
+        } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+            Ptr = SI->getPointerOperand();
+            Volatile = SI->isVolatile();
+        } else if (auto *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+            Ptr = RMW->getPointerOperand();
+            Volatile = RMW->isVolatile();
+        } else if (auto *CmpXchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+            Ptr = CmpXchg->getPointerOperand();
+            Volatile = CmpXchg->isVolatile();
+        } else if (auto *VAArg = dyn_cast<VAArgInst>(&I)) {
+            Ptr = VAArg->getPointerOperand();
+        }
+        bool Reads = I.mayReadFromMemory(), Writes = I.mayWriteToMemory();
+        if (Ptr && !Volatile) {
+            Ret |= getAccessEffects(Ptr, Reads, Writes);
+        } else {
+            // e.g., fences and volatile accesses, they are visible to others
+            Ret |= (Reads ? ME_ReadOther : ME_None) | (Writes ? ME_WriteOther : ME_None);
+        }
+    }
+    return Ret;
+}
+
+unsigned FunctionAttrInference::getCallEffects(CallBase *CB, Function *Caller) {
+    unsigned CalleeEffects = ME_None;
+    SmallVector<Function *, 4> Callees;
+    if (getCallees(CB, Caller, Callees)) {
+        for (auto *Callee: Callees) CalleeEffects |= getCalleeEffects(CB, Callee);
+    } else {
+        CalleeEffects = getAttributeEffects(CB, nullptr);
+    }
+
+    // the effects on the memory of arguments are mapped to the actual arguments
+    unsigned Ret = CalleeEffects & (ME_ReadOther | ME_WriteOther);
+    bool ReadArg = CalleeEffects & ME_ReadArg, WriteArg = CalleeEffects & ME_WriteArg;
+    if (ReadArg || WriteArg) {
+        for (unsigned K = 0; K < CB->arg_size(); ++K) {
+            auto *Arg = CB->getArgOperand(K);
+            if (!Arg->getType()->isPointerTy() || CB->doesNotAccessMemory(K)) continue;
+            Ret |= getAccessEffects(Arg, ReadArg && !CB->onlyWritesMemory(K), WriteArg && !CB->onlyReadsMemory(K));
+        }
+    }
+    return Ret;
+}
+
+unsigned FunctionAttrInference::getCalleeEffects(CallBase *CB, Function *Callee) {
+    auto It = Effects.find(Callee);
+    if (It != Effects.end()) return It->second;
+    return getAttributeEffects(CB, Callee);
+}
+
+bool FunctionAttrInference::getCallees(CallBase *CB, Function *Caller, SmallVectorImpl<Function *> &Callees) const {
+    if (auto *Callee = CB->getCalledFunction()) {
+        Callees.push_back(Callee);
+        return true;
+    }
+    if (CB->isInlineAsm()) return false;
+
+    auto *CallerNode = DyckCG->getFunction(Caller);
+    auto *PC = dyn_cast_or_null<PointerCall>(CallerNode ? CallerNode->getCall(CB) : nullptr);
+    if (!PC || PC->empty()) return false;
+    Callees.append(PC->begin(), PC->end());
+    return true;
+}
+
+bool FunctionAttrInference::mayCapture(Value *V, Function *F, bool ReturnCaptures) const {
+    DyckCaptureTracker Tracker([this, F](CallBase *CB, SmallVectorImpl<Function *> &Callees) {
+        return getCallees(CB, F, Callees);
+    }, ReturnCaptures);
+    PointerMayBeCaptured(V, &Tracker);
+    return Tracker.Captured;
+}
+
+bool FunctionAttrInference::isMallocLike(Function *F) const {
+    bool HasRet = false;
+    for (auto &I: instructions(F)) {
+        auto *Ret = dyn_cast<ReturnInst>(&I);
+        if (!Ret) continue;
+        HasRet = true;
+
+        // each returned object is null or a fresh allocation that does not escape except being returned
+        SmallVector<const Value *, 4> Objs;
+        getUnderlyingObjects(Ret->getReturnValue(), Objs);
+        for (auto *Obj: Objs) {
+            if (isa<ConstantPointerNull>(Obj) || isa<UndefValue>(Obj)) continue;
+            auto *CB = const_cast<CallBase *>(dyn_cast<CallBase>(Obj));
+            if (!CB) return false;
+            if (!CB->returnDoesNotAlias()) {
+                SmallVector<Function *, 4> Callees;
+                if (!getCallees(CB, F, Callees)) return false;
+                for (auto *Callee: Callees)
+                    if (!Callee->returnDoesNotAlias()) return false;
+            }
+            if (mayCapture(CB, F, false)) return false;
+        }
+    }
+    return HasRet;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/Transforms/Utils/CallPromotionUtils.h>
+#include "DyckAA/AliasQueryProfiler.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+#include "Support/RecursiveTimer.h"
+#include "Transform/IndirectCallPromotion.h"
+
+#include <vector>
+
+#define DEBUG_TYPE "IndirectCallPromotion"
+
+char IndirectCallPromotion::ID = 0;
+static RegisterPass<IndirectCallPromotion> X(DEBUG_TYPE, "Promoting indirect calls resolved by dyck-aa");
+
+void IndirectCallPromotion::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<DyckAliasAnalysis>();
+}
+
+bool IndirectCallPromotion::runOnModule(Module &M) {
+    RecursiveTimer Timer("Promoting indirect calls");
+    AliasQueryProfiler::ClientScope Client("IndirectCallPromotion");
+    auto *DyckCG = getAnalysis<DyckAliasAnalysis>().getDyckCallGraph();
+
+    // collect the candidates first, the call graph refers to the instructions we are going to change
+    std::vector<std::pair<CallBase *, std::vector<Function *>>> Candidates;
+    unsigned NumPointerCalls = 0;
+    for (auto It = DyckCG->nodes_begin(), E = DyckCG->nodes_end(); It != E; ++It) {
+        auto *CGNode = *It;
+        for (auto PIt = CGNode->pointer_call_begin(), PE = CGNode->pointer_call_end(); PIt != PE; ++PIt) {
+            auto *PC = *PIt;
+            auto *CB = dyn_cast_or_null<CallBase>(PC->getInstruction());
+            // implicit calls, e.g., those in pthread_create, have no instruction to promote
+            if (!CB || CB->getCalledFunction()) continue;
+            NumPointerCalls++;
+            if (PC->empty() || PC->size() > MaxTargets) continue;
+
+            std::vector<Function *> Targets;
+            for (auto *Target: *PC) {
+                if (isLegalToPromote(*CB, Target)) Targets.push_back(Target);
+            }
+            if (!Targets.empty()) Candidates.emplace_back(CB, std::move(Targets));
+        }
+    }
+
+    // each promotion moves the indirect call into the else branch, so the next target guards it again
+    unsigned NumTargets = 0;
+    for (auto &Candidate: Candidates) {
+        for (auto *Target: Candidate.second) {
+            promoteCallWithIfThenElse(*Candidate.first, Target);
+            NumTargets++;
+        }
+    }
+    outs() << "Promoted " << Candidates.size() << " of " << NumPointerCalls << " pointer calls to "
+           << NumTargets << " guarded direct calls.\n";
+    return !Candidates.empty();
+}
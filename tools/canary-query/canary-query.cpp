@@ -0,0 +1,231 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// A query tool over the alias index written by canary -dump-alias-index.
+/// It maps the file into memory and does not depend on LLVM.
+///
+/// usage: canary-query <index file> [request]
+/// If no request is given, requests are read from stdin, one per line.
+/// Requests:
+///   alias <key1> <key2>, aliasset <key>, null <key>, callees <key>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Support/AliasIndexFormat.h"
+
+class AliasIndexReader {
+private:
+    const char *Base = nullptr;
+    size_t Size = 0;
+    const AliasIndexHeader *Header = nullptr;
+    const AliasIndexKey *Keys = nullptr;
+    const char *Strings = nullptr;
+    const uint32_t *ClassBegins = nullptr;
+    const uint32_t *Members = nullptr;
+    const uint32_t *MayNull = nullptr;
+    const AliasIndexCallSite *CallSites = nullptr;
+    const uint32_t *Callees = nullptr;
+    size_t StringsSize = 0;
+
+    /// return true if \p Count elements of \p ElemSize bytes at \p Offset are in the file and aligned
+    bool isSection(uint64_t Offset, uint64_t Count, uint64_t ElemSize) const {
+        if (Offset < sizeof(AliasIndexHeader) || Offset > Size || Offset % (ElemSize < 4 ? ElemSize : 4)) return false;
+        return Count <= (Size - Offset) / ElemSize;
+    }
+
+    /// return true if the string of key \p K is in the string pool
+    bool hasString(uint32_t K) const {
+        return Keys[K].StringOffset <= StringsSize && Keys[K].StringLength <= StringsSize - Keys[K].StringOffset;
+    }
+
+public:
+    static const uint32_t NotFound = ~0U;
+
+    ~AliasIndexReader() {
+        if (Base) munmap((void *) Base, Size);
+    }
+
+    bool open(const char *FileName) {
+        int Fd = ::open(FileName, O_RDONLY);
+        if (Fd < 0) return false;
+        struct stat St{};
+        if (fstat(Fd, &St) < 0 || (size_t) St.st_size < sizeof(AliasIndexHeader)) {
+            close(Fd);
+            return false;
+        }
+        Size = St.st_size;
+        void *Addr = mmap(nullptr, Size, PROT_READ, MAP_SHARED, Fd, 0);
+        close(Fd);
+        if (Addr == MAP_FAILED) return false;
+        Base = (const char *) Addr;
+
+        Header = (const AliasIndexHeader *) Base;
+        if (memcmp(Header->Magic, AliasIndex::Magic, sizeof(Header->Magic)) != 0) return false;
+        if (Header->Version != AliasIndex::Version) return false;
+        // a truncated or corrupted file must not make the sections exceed the mapping
+        if (!isSection(Header->KeysOffset, Header->NumKeys, sizeof(AliasIndexKey))
+            || !isSection(Header->StringsOffset, 0, 1)
+            || !isSection(Header->ClassBeginsOffset, (uint64_t) Header->NumClasses + 1, sizeof(uint32_t))
+            || !isSection(Header->MembersOffset, Header->NumMembers, sizeof(uint32_t))
+            || !isSection(Header->MayNullOffset, ((uint64_t) Header->NumClasses + 31) / 32, sizeof(uint32_t))
+            || !isSection(Header->CallSitesOffset, Header->NumCallSites, sizeof(AliasIndexCallSite))
+            || !isSection(Header->CalleesOffset, Header->NumCallees, sizeof(uint32_t)))
+            return false;
+        Keys = (const AliasIndexKey *) (Base + Header->KeysOffset);
+        Strings = Base + Header->StringsOffset;
+        StringsSize = Size - Header->StringsOffset;
+        ClassBegins = (const uint32_t *) (Base + Header->ClassBeginsOffset);
+        Members = (const uint32_t *) (Base + Header->MembersOffset);
+        MayNull = (const uint32_t *) (Base + Header->MayNullOffset);
+        CallSites = (const AliasIndexCallSite *) (Base + Header->CallSitesOffset);
+        Callees = (const uint32_t *) (Base + Header->CalleesOffset);
+        return true;
+    }
+
+    std::string key(uint32_t K) const {
+        if (K >= Header->NumKeys || !hasString(K)) return {};
+        return {Strings + Keys[K].StringOffset, Keys[K].StringLength};
+    }
+
+    /// binary search of the key
+    uint32_t find(const std::string &Key) const {
+        uint32_t Low = 0, High = Header->NumKeys;
+        while (Low < High) {
+            uint32_t Mid = Low + (High - Low) / 2;
+            const AliasIndexKey &Entry = Keys[Mid];
+            if (!hasString(Mid)) return NotFound;
+            int Cmp = memcmp(Strings + Entry.StringOffset, Key.data(), std::min<size_t>(Entry.StringLength, Key.size()));
+            if (Cmp == 0) Cmp = Entry.StringLength < Key.size() ? -1 : (Entry.StringLength > Key.size() ? 1 : 0);
+            if (Cmp == 0) return Mid;
+            if (Cmp < 0) Low = Mid + 1;
+            else High = Mid;
+        }
+        return NotFound;
+    }
+
+    uint32_t classOf(uint32_t K) const {
+        if (K == NotFound || Keys[K].ClassID >= Header->NumClasses) return NotFound;
+        return Keys[K].ClassID;
+    }
+
+    bool mayAlias(uint32_t K1, uint32_t K2) const {
+        if (K1 == K2) return true;
+        uint32_t C1 = classOf(K1);
+        return C1 != NotFound && C1 == classOf(K2);
+    }
+
+    bool mayNull(uint32_t K) const {
+        uint32_t C = classOf(K);
+        return C != NotFound && (MayNull[C / 32] >> (C % 32) & 1);
+    }
+
+    std::vector<uint32_t> aliasSet(uint32_t K) const {
+        uint32_t C = classOf(K);
+        if (C == NotFound) return {};
+        uint32_t Begin = ClassBegins[C], End = ClassBegins[C + 1];
+        if (Begin > End || End > Header->NumMembers) return {};
+        return {Members + Begin, Members + End};
+    }
+
+    std::vector<uint32_t> callees(uint32_t K) const {
+        const AliasIndexCallSite *Begin = CallSites, *End = CallSites + Header->NumCallSites;
+        auto *It = std::lower_bound(Begin, End, K, [](const AliasIndexCallSite &S, uint32_t Key) {
+            return S.Key < Key;
+        });
+        if (It == End || It->Key != K) return {};
+        if (It->CalleesBegin > It->CalleesEnd || It->CalleesEnd > Header->NumCallees) return {};
+        return {Callees + It->CalleesBegin, Callees + It->CalleesEnd};
+    }
+};
+
+static std::string handleRequest(const AliasIndexReader &Reader, const std::string &Request) {
+    std::istringstream In(Request);
+    std::string Kind, Key1, Key2;
+    In >> Kind >> Key1 >> Key2;
+    if (Kind.empty()) return "error: empty request";
+    if (Key1.empty() || (Kind == "alias" && Key2.empty())) return "error: missing operands";
+
+    uint32_t K1 = Reader.find(Key1);
+    if (K1 == AliasIndexReader::NotFound && Kind != "alias") return "error: unknown value " + Key1;
+    std::string Ret;
+    auto Join = [&Reader, &Ret](const std::vector<uint32_t> &Ks) {
+        for (unsigned K = 0; K < Ks.size(); ++K) Ret += (K ? " " : "") + Reader.key(Ks[K]);
+    };
+    if (Kind == "alias") {
+        // unknown values only alias themselves
+        if (Key1 == Key2) return "1";
+        uint32_t K2 = Reader.find(Key2);
+        if (K1 == AliasIndexReader::NotFound || K2 == AliasIndexReader::NotFound) return "0";
+        return Reader.mayAlias(K1, K2) ? "1" : "0";
+    } else if (Kind == "aliasset") {
+        Join(Reader.aliasSet(K1));
+    } else if (Kind == "null") {
+        Ret = Reader.mayNull(K1) ? "1" : "0";
+    } else if (Kind == "callees") {
+        Join(Reader.callees(K1));
+    } else {
+        return "error: unknown request " + Kind;
+    }
+    return Ret;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <index file> [request]\n", argv[0]);
+        return 1;
+    }
+    AliasIndexReader Reader;
+    if (!Reader.open(argv[1])) {
+        fprintf(stderr, "error: %s is not a valid alias index\n", argv[1]);
+        return 1;
+    }
+
+    if (argc > 2) {
+        std::string Request;
+        for (int K = 2; K < argc; ++K) Request += std::string(K > 2 ? " " : "") + argv[K];
+        std::cout << handleRequest(Reader, Request) << "\n";
+        return 0;
+    }
+
+    std::string Request;
+    unsigned long NumRequests = 0;
+    std::chrono::steady_clock::duration Time{};
+    while (std::getline(std::cin, Request)) {
+        auto Begin = std::chrono::steady_clock::now();
+        std::string Response = handleRequest(Reader, Request);
+        Time += std::chrono::steady_clock::now() - Begin;
+        ++NumRequests;
+        std::cout << Response << "\n";
+    }
+    if (NumRequests) {
+        auto Us = std::chrono::duration_cast<std::chrono::microseconds>(Time).count();
+        fprintf(stderr, "%lu requests, %.3f us per request\n", NumRequests, (double) Us / NumRequests);
+    }
+    return 0;
+}
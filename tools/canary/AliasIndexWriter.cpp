@@ -0,0 +1,195 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "AliasIndexWriter.h"
+#include "DyckAA/AliasQueryProfiler.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+#include "Support/AliasIndexFormat.h"
+#include "Support/RecursiveTimer.h"
+#include "Support/ValueKey.h"
+
+char AliasIndexWriter::ID = 0;
+
+namespace {
+    struct KeyInfo {
+        uint32_t ClassID = DyckAliasAnalysis::InvalidClassID;
+        uint32_t Flags = 0;
+        uint32_t Index = 0; // index after sorting
+    };
+}
+
+template<class T>
+static void writeArray(raw_ostream &OS, const std::vector<T> &Vec) {
+    OS.write((const char *) Vec.data(), Vec.size() * sizeof(T));
+}
+
+static uint64_t align(raw_ostream &OS) {
+    while (OS.tell() % 8) OS << '\0';
+    return OS.tell();
+}
+
+void AliasIndexWriter::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<DyckAliasAnalysis>();
+}
+
+bool AliasIndexWriter::runOnModule(Module &M) {
+    RecursiveTimer DumpTimer("Dumping the alias index to " + FileName);
+    AliasQueryProfiler::ClientScope Client("AliasIndexWriter");
+    auto *DAA = &getAnalysis<DyckAliasAnalysis>();
+    ValueKey Keys(M);
+
+    // collect keys: values in the alias classes, pointer operands, call sites and callees
+    StringMap<KeyInfo> KeyMap;
+    unsigned NumClasses = DAA->getNumAliasClasses();
+    for (unsigned ID = 0; ID < NumClasses; ++ID) {
+        for (auto *V: DAA->getAliasClassMembers(ID)) {
+            std::string Key = Keys.get(V);
+            if (!Key.empty()) KeyMap[Key].ClassID = ID;
+        }
+    }
+    for (auto &F: M) {
+        for (auto &I: instructions(F)) {
+            std::string InstKey = Keys.get(&I);
+            for (unsigned K = 0; K < I.getNumOperands(); ++K) {
+                if (!I.getOperand(K)->getType()->isPointerTy()) continue;
+                unsigned ID = DAA->getAliasClassID(I.getOperand(K));
+                if (ID == DyckAliasAnalysis::InvalidClassID) continue;
+                auto &Info = KeyMap[InstKey + ":" + std::to_string(K)];
+                Info.ClassID = ID;
+                Info.Flags = AliasIndex::OperandKey;
+            }
+        }
+    }
+    std::vector<std::pair<Instruction *, std::vector<Function *>>> CallSites;
+    auto *DyckCG = DAA->getDyckCallGraph();
+    for (auto It = DyckCG->nodes_begin(), E = DyckCG->nodes_end(); It != E; ++It) {
+        auto *CGNode = *It;
+        std::map<Instruction *, std::vector<Function *>> Targets;
+        for (auto CIt = CGNode->common_call_begin(), CE = CGNode->common_call_end(); CIt != CE; ++CIt)
+            if ((*CIt)->getInstruction()) Targets[(*CIt)->getInstruction()].push_back((*CIt)->getCalledFunction());
+        for (auto PIt = CGNode->pointer_call_begin(), PE = CGNode->pointer_call_end(); PIt != PE; ++PIt)
+            if ((*PIt)->getInstruction())
+                Targets[(*PIt)->getInstruction()].insert(Targets[(*PIt)->getInstruction()].end(), (*PIt)->begin(), (*PIt)->end());
+        // values without stable keys cannot be named by the queries, so they are skipped
+        for (auto &Site: Targets) {
+            std::string SiteKey = Keys.get(Site.first);
+            if (SiteKey.empty()) continue;
+            std::vector<Function *> SiteCallees;
+            for (auto *Callee: Site.second) {
+                std::string CalleeKey = Callee ? Keys.get(Callee) : "";
+                if (CalleeKey.empty()) continue;
+                KeyMap.try_emplace(CalleeKey);
+                SiteCallees.push_back(Callee);
+            }
+            KeyMap.try_emplace(SiteKey);
+            CallSites.emplace_back(Site.first, std::move(SiteCallees));
+        }
+    }
+    KeyMap.erase("");
+
+    // sort the keys for binary search
+    std::vector<StringMapEntry<KeyInfo> *> Sorted;
+    for (auto &Entry: KeyMap) Sorted.push_back(&Entry);
+    std::sort(Sorted.begin(), Sorted.end(), [](StringMapEntry<KeyInfo> *A, StringMapEntry<KeyInfo> *B) {
+        return A->getKey() < B->getKey();
+    });
+
+    std::vector<AliasIndexKey> KeyTable;
+    std::string Strings;
+    std::vector<std::vector<uint32_t>> ClassMembers(NumClasses);
+    for (unsigned K = 0; K < Sorted.size(); ++K) {
+        auto &Info = Sorted[K]->getValue();
+        Info.Index = K;
+        KeyTable.push_back({(uint32_t) Strings.size(), (uint32_t) Sorted[K]->getKey().size(), Info.ClassID, Info.Flags});
+        Strings += Sorted[K]->getKey().str();
+        if (!(Info.Flags & AliasIndex::OperandKey) && Info.ClassID != DyckAliasAnalysis::InvalidClassID)
+            ClassMembers[Info.ClassID].push_back(K);
+    }
+
+    std::vector<uint32_t> ClassBegins, Members;
+    std::vector<uint32_t> MayNull((NumClasses + 31) / 32);
+    for (unsigned ID = 0; ID < NumClasses; ++ID) {
+        ClassBegins.push_back(Members.size());
+        Members.insert(Members.end(), ClassMembers[ID].begin(), ClassMembers[ID].end());
+        if (DAA->mayNullClass(ID)) MayNull[ID / 32] |= 1U << (ID % 32);
+    }
+    ClassBegins.push_back(Members.size());
+
+    std::vector<AliasIndexCallSite> SiteTable;
+    std::vector<uint32_t> Callees;
+    // call sites are written in the order of their keys, so that the file does not depend on addresses
+    std::vector<std::pair<uint32_t, std::vector<Function *> *>> SortedSites;
+    for (auto &Site: CallSites) SortedSites.emplace_back(KeyMap.lookup(Keys.get(Site.first)).Index, &Site.second);
+    std::sort(SortedSites.begin(), SortedSites.end(), [](const std::pair<uint32_t, std::vector<Function *> *> &A,
+                                                         const std::pair<uint32_t, std::vector<Function *> *> &B) {
+        return A.first < B.first;
+    });
+    for (auto &Site: SortedSites) {
+        AliasIndexCallSite Entry{Site.first, (uint32_t) Callees.size(), 0};
+        std::vector<uint32_t> SiteCallees;
+        for (auto *Callee: *Site.second) SiteCallees.push_back(KeyMap.lookup(Keys.get(Callee)).Index);
+        std::sort(SiteCallees.begin(), SiteCallees.end());
+        SiteCallees.erase(std::unique(SiteCallees.begin(), SiteCallees.end()), SiteCallees.end());
+        Callees.insert(Callees.end(), SiteCallees.begin(), SiteCallees.end());
+        Entry.CalleesEnd = Callees.size();
+        SiteTable.push_back(Entry);
+    }
+
+    std::error_code EC;
+    raw_fd_ostream OS(FileName, EC, sys::fs::OF_None);
+    if (EC) {
+        errs() << "ERROR: cannot open " << FileName << ": " << EC.message() << "\n";
+        return false;
+    }
+    AliasIndexHeader Header{};
+    memcpy(Header.Magic, AliasIndex::Magic, sizeof(Header.Magic));
+    Header.Version = AliasIndex::Version;
+    Header.NumKeys = KeyTable.size();
+    Header.NumClasses = NumClasses;
+    Header.NumMembers = Members.size();
+    Header.NumCallSites = SiteTable.size();
+    Header.NumCallees = Callees.size();
+    OS.write((const char *) &Header, sizeof(Header));
+    Header.KeysOffset = align(OS);
+    writeArray(OS, KeyTable);
+    Header.StringsOffset = align(OS);
+    OS << Strings;
+    Header.ClassBeginsOffset = align(OS);
+    writeArray(OS, ClassBegins);
+    Header.MembersOffset = align(OS);
+    writeArray(OS, Members);
+    Header.MayNullOffset = align(OS);
+    writeArray(OS, MayNull);
+    Header.CallSitesOffset = align(OS);
+    writeArray(OS, SiteTable);
+    Header.CalleesOffset = align(OS);
+    writeArray(OS, Callees);
+    OS.seek(0);
+    OS.write((const char *) &Header, sizeof(Header));
+    return false;
+}
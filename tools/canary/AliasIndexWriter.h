@@ -0,0 +1,46 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANARY_ALIASINDEXWRITER_H
+#define CANARY_ALIASINDEXWRITER_H
+
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+#include <string>
+
+using namespace llvm;
+
+/// Writes the alias classes, may-null bits and call targets into a memory-mappable file,
+/// see Support/AliasIndexFormat.h for the layout.
+class AliasIndexWriter : public ModulePass {
+private:
+    std::string FileName;
+
+public:
+    static char ID;
+
+    explicit AliasIndexWriter(std::string FileName) : ModulePass(ID), FileName(std::move(FileName)) {}
+
+    ~AliasIndexWriter() override = default;
+
+    void getAnalysisUsage(AnalysisUsage &) const override;
+
+    bool runOnModule(Module &) override;
+};
+
+#endif // CANARY_ALIASINDEXWRITER_H
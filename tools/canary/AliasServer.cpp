@@ -0,0 +1,290 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/Support/MathExtras.h>
+#include <llvm/Support/raw_ostream.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+
+#include "AliasServer.h"
+#include "DyckAA/AliasQueryProfiler.h"
+#include "DyckAA/DyckAliasAnalysis.h"
+#include "NullPointer/NullCheckAnalysis.h"
+#include "Support/RecursiveTimer.h"
+
+char AliasServer::ID = 0;
+
+AliasServer::AliasServer(std::string SocketPath) : ModulePass(ID), SocketPath(std::move(SocketPath)), Stopped(false) {
+}
+
+void AliasServer::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<DyckAliasAnalysis>();
+    AU.addRequired<NullCheckAnalysis>();
+}
+
+bool AliasServer::runOnModule(Module &M) {
+    DAA = &getAnalysis<DyckAliasAnalysis>();
+    NCA = &getAnalysis<NullCheckAnalysis>();
+    Keys = std::make_unique<ValueKey>(M);
+
+    // the reversed call graph for "callers" requests
+    auto *DyckCG = DAA->getDyckCallGraph();
+    for (auto It = DyckCG->nodes_begin(), E = DyckCG->nodes_end(); It != E; ++It) {
+        auto *CGNode = *It;
+        for (auto EIt = CGNode->child_edge_begin(), EE = CGNode->child_edge_end(); EIt != EE; ++EIt) {
+            if (!EIt->first) continue; // edges from the external calling node
+            auto *Inst = EIt->first->getInstruction();
+            auto *Callee = EIt->second->getLLVMFunction();
+            if (Inst && Callee) Callers[Callee].push_back(Inst);
+        }
+    }
+
+    ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un Addr{};
+    Addr.sun_family = AF_UNIX;
+    if (ListenFd < 0 || SocketPath.size() >= sizeof(Addr.sun_path)) {
+        errs() << "ERROR: cannot create the socket " << SocketPath << "\n";
+        return false;
+    }
+    strncpy(Addr.sun_path, SocketPath.c_str(), sizeof(Addr.sun_path) - 1);
+    unlink(SocketPath.c_str());
+    if (bind(ListenFd, (sockaddr *) &Addr, sizeof(Addr)) < 0 || listen(ListenFd, 64) < 0) {
+        errs() << "ERROR: cannot listen on " << SocketPath << ": " << strerror(errno) << "\n";
+        close(ListenFd);
+        return false;
+    }
+
+    {
+        RecursiveTimer ServeTimer("Serving alias queries on " + SocketPath);
+        while (!Stopped) {
+            int Fd = accept(ListenFd, nullptr, nullptr);
+            if (Fd < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            // a connection may idle for long, so each one has its own thread instead of a pool worker
+            {
+                std::lock_guard<std::mutex> Lock(ConnectionMutex);
+                Connections.insert(Fd);
+                // accepted while a shutdown request shuts down the others
+                if (Stopped) shutdown(Fd, SHUT_RD);
+            }
+            std::thread([this, Fd]() {
+                serveConnection(Fd);
+                // the fd is removed before it is closed, so that its number is never shut down after reuse
+                std::lock_guard<std::mutex> Lock(ConnectionMutex);
+                Connections.erase(Fd);
+                close(Fd);
+                if (Connections.empty()) ConnectionsDone.notify_all();
+            }).detach();
+        }
+        std::unique_lock<std::mutex> Lock(ConnectionMutex);
+        ConnectionsDone.wait(Lock, [this]() { return Connections.empty(); });
+    }
+    close(ListenFd);
+    unlink(SocketPath.c_str());
+    outs() << getStatistics() << "\n";
+    return false;
+}
+
+void AliasServer::serveConnection(int Fd) {
+    std::string Buffer;
+    char Chunk[4096];
+    // the rest of a request that is too long is dropped until its end
+    bool Skipping = false;
+    while (true) {
+        auto Size = read(Fd, Chunk, sizeof(Chunk));
+        if (Size <= 0) break;
+        Buffer.append(Chunk, Size);
+        if (Skipping) {
+            size_t End = Buffer.find('\n');
+            if (End == std::string::npos) {
+                Buffer.clear();
+                continue;
+            }
+            Buffer.erase(0, End + 1);
+            Skipping = false;
+        }
+
+        size_t Begin = 0, End;
+        std::string Responses;
+        while ((End = Buffer.find('\n', Begin)) != std::string::npos) {
+            Responses += handleRequest(StringRef(Buffer).slice(Begin, End).trim());
+            Responses += '\n';
+            Begin = End + 1;
+        }
+        Buffer.erase(0, Begin);
+        if (Buffer.size() > MaxRequestSize) {
+            Responses += "error: request too long\n";
+            Buffer.clear();
+            Skipping = true;
+        }
+
+        // a client that has gone away must not kill the server by SIGPIPE
+        for (size_t Written = 0; Written < Responses.size();) {
+            auto N = send(Fd, Responses.data() + Written, Responses.size() - Written, MSG_NOSIGNAL);
+            if (N < 0 && errno == EINTR) continue;
+            if (N <= 0) break;
+            Written += N;
+        }
+    }
+}
+
+std::string AliasServer::handleRequest(StringRef Request) {
+    AliasQueryProfiler::ClientScope Client("AliasServer");
+    auto Begin = std::chrono::steady_clock::now();
+    SmallVector<StringRef, 3> Words;
+    Request.split(Words, ' ', -1, false);
+    if (Words.empty()) return "error: empty request";
+    StringRef Kind = Words[0];
+    StringRef StatKind = Kind;
+
+    std::string Ret;
+    raw_string_ostream Out(Ret);
+    auto Resolve = [this, &Words, &Out](unsigned K, Instruction **Context = nullptr) -> Value * {
+        if (K >= Words.size()) {
+            Out << "error: missing operands";
+            return nullptr;
+        }
+        auto *V = Keys->resolve(Words[K], Context);
+        if (!V) Out << "error: unknown value " << Words[K];
+        return V;
+    };
+
+    if (Kind == "alias") {
+        auto *V1 = Resolve(1);
+        auto *V2 = V1 ? Resolve(2) : nullptr;
+        if (V1 && V2) Out << DAA->mayAlias(V1, V2);
+    } else if (Kind == "aliasset") {
+        if (auto *V = Resolve(1)) {
+            bool First = true;
+            for (auto *Member: DAA->getAliasSet(V)) {
+                std::string Key = Keys->get(Member);
+                if (Key.empty()) continue;
+                Out << (First ? "" : " ") << Key;
+                First = false;
+            }
+        }
+    } else if (Kind == "null") {
+        Instruction *Context;
+        if (auto *V = Resolve(1, &Context)) {
+            if (Context && Context != V) {
+                std::lock_guard<std::mutex> Lock(NullMutex);
+                Out << NCA->mayNull(V, Context);
+            } else {
+                Out << DAA->mayNull(V);
+            }
+        }
+    } else if (Kind == "callees") {
+        if (auto *V = Resolve(1)) {
+            std::vector<Instruction *> Insts;
+            if (auto *F = dyn_cast<Function>(V)) {
+                for (auto &I: instructions(F)) Insts.push_back(&I);
+            } else if (auto *I = dyn_cast<Instruction>(V)) {
+                Insts.push_back(I);
+            }
+            std::set<Function *> Callees;
+            for (auto *I: Insts) {
+                auto *CGNode = DAA->getDyckCallGraph()->getFunction(I->getFunction());
+                auto *C = CGNode ? CGNode->getCall(I) : nullptr;
+                if (auto *CC = dyn_cast_or_null<CommonCall>(C)) Callees.insert(CC->getCalledFunction());
+                else if (auto *PC = dyn_cast_or_null<PointerCall>(C)) Callees.insert(PC->begin(), PC->end());
+            }
+            bool First = true;
+            for (auto *Callee: Callees) {
+                Out << (First ? "" : " ") << Keys->get(Callee);
+                First = false;
+            }
+        }
+    } else if (Kind == "callers") {
+        if (auto *V = Resolve(1)) {
+            auto It = Callers.find(dyn_cast<Function>(V));
+            if (!isa<Function>(V)) {
+                Out << "error: not a function " << Words[1];
+            } else if (It != Callers.end()) {
+                bool First = true;
+                for (auto *I: It->second) {
+                    Out << (First ? "" : " ") << Keys->get(I);
+                    First = false;
+                }
+            }
+        }
+    } else if (Kind == "stats") {
+        Out << getStatistics();
+    } else if (Kind == "shutdown") {
+        Stopped = true;
+        shutdown(ListenFd, SHUT_RDWR); // wake up the accept loop
+        {
+            // the pending reads return, so the connections finish after answering what they have received
+            std::lock_guard<std::mutex> Lock(ConnectionMutex);
+            for (int Fd: Connections) shutdown(Fd, SHUT_RD);
+        }
+        Out << "bye";
+    } else {
+        Out << "error: unknown request " << Kind;
+        StatKind = "unknown"; // do not let bad requests grow the statistics
+    }
+    Out.flush();
+
+    auto Latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Begin);
+    std::lock_guard<std::mutex> Lock(StatsMutex);
+    Latencies[StatKind.str()].add(Latency.count());
+    return Ret;
+}
+
+void AliasServer::LatencyStats::add(uint64_t Value) {
+    Count++;
+    Sum += Value;
+    Max = std::max(Max, Value);
+    unsigned K = Value == 0 ? 0 : Log2_64(Value);
+    Buckets[K < NumBuckets ? K : NumBuckets - 1]++;
+}
+
+uint64_t AliasServer::LatencyStats::percentile(unsigned Percent) const {
+    // the upper bound of the bucket that the percentile falls in
+    uint64_t Rank = (Count * Percent + 99) / 100, Seen = 0;
+    for (unsigned K = 0; K < NumBuckets; ++K) {
+        Seen += Buckets[K];
+        if (Seen >= Rank) return std::min(Max, ((uint64_t) 2 << K) - 1);
+    }
+    return Max;
+}
+
+std::string AliasServer::getStatistics() {
+    std::string Ret;
+    raw_string_ostream Out(Ret);
+    std::lock_guard<std::mutex> Lock(StatsMutex);
+    Out << "latency(us):";
+    for (auto &It: Latencies) {
+        auto &Stats = It.second;
+        Out << " " << It.first << "[n=" << Stats.Count << " mean=" << Stats.Sum / Stats.Count
+            << " p50<=" << Stats.percentile(50) << " p99<=" << Stats.percentile(99) << " max=" << Stats.Max << "]";
+    }
+    Out.flush();
+    return Ret;
+}
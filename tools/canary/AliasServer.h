@@ -0,0 +1,115 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANARY_ALIASSERVER_H
+#define CANARY_ALIASSERVER_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Pass.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Support/ValueKey.h"
+
+using namespace llvm;
+
+class DyckAliasAnalysis;
+class NullCheckAnalysis;
+
+/// Answers alias, null and call graph queries about an analyzed module over a unix domain socket.
+///
+/// Each request is a line of space-separated words, and each response is a line.
+/// Values are named by the keys of ValueKey.
+///   alias <key1> <key2>  - 1 if the two values may alias, otherwise 0
+///   aliasset <key>       - keys of the values in the alias set
+///   null <key>           - 1 if the value may be null, otherwise 0; an operand key is checked at its user
+///   callees <key>        - functions called by a call instruction, or by all calls in a function (@name)
+///   callers <@name>      - call instructions that may call the function
+///   stats                - latency statistics of the requests served so far
+///   shutdown             - stop the server, the requests already received are still answered
+/// A malformed request gets a line starting with "error:", so does a request longer than MaxRequestSize,
+/// which is skipped without being buffered.
+class AliasServer : public ModulePass {
+public:
+    static const size_t MaxRequestSize = 64 * 1024;
+
+private:
+    std::string SocketPath;
+
+    DyckAliasAnalysis *DAA = nullptr;
+    NullCheckAnalysis *NCA = nullptr;
+    std::unique_ptr<ValueKey> Keys;
+    DenseMap<const Function *, std::vector<Instruction *>> Callers;
+
+    /// the null check analysis is not designed for concurrent queries
+    std::mutex NullMutex;
+
+    /// latencies (in microseconds) of a kind of requests, in log2 buckets like AliasQueryProfiler,
+    /// so that the memory does not grow with the requests
+    struct LatencyStats {
+        static const unsigned NumBuckets = 32;
+        uint64_t Count = 0;
+        uint64_t Sum = 0;
+        uint64_t Max = 0;
+        /// the K-th bucket counts latencies in [2^K, 2^(K+1))
+        uint64_t Buckets[NumBuckets] = {};
+
+        void add(uint64_t Value);
+
+        /// an upper bound of the \p Percent-th percentile
+        uint64_t percentile(unsigned Percent) const;
+    };
+    std::map<std::string, LatencyStats> Latencies;
+    std::mutex StatsMutex;
+
+    /// the sockets of the connections being served, each by its own thread.
+    /// they are shut down for reading on shutdown, so that idle clients cannot keep the server running
+    std::set<int> Connections;
+    std::mutex ConnectionMutex;
+    std::condition_variable ConnectionsDone;
+
+    std::atomic<bool> Stopped;
+    int ListenFd = -1;
+
+public:
+    static char ID;
+
+    explicit AliasServer(std::string SocketPath);
+
+    ~AliasServer() override = default;
+
+    void getAnalysisUsage(AnalysisUsage &) const override;
+
+    bool runOnModule(Module &) override;
+
+private:
+    void serveConnection(int Fd);
+
+    std::string handleRequest(StringRef Request);
+
+    std::string getStatistics();
+};
+
+#endif // CANARY_ALIASSERVER_H
@@ -36,9 +36,14 @@
 
 #include <memory>
 
+#include "AliasIndexWriter.h"
+#include "AliasServer.h"
 #include "NullPointer/NullCheckAnalysis.h"
 #include "Support/RecursiveTimer.h"
 #include "Support/Statistics.h"
+#include "Transform/AliasScopeMetadata.h"
+#include "Transform/FunctionAttrInference.h"
+#include "Transform/IndirectCallPromotion.h"
 #include "Transform/LowerConstantExpr.h"
 
 using namespace llvm;
@@ -53,6 +58,27 @@ static cl::opt<bool> OutputAssembly("S", cl::desc("Write output as LLVM assembly
 
 static cl::opt<bool> OnlyStatistics("s", cl::desc("Only output statistics"), cl::init(false));
 
+static cl::opt<std::string> AliasIndexFile("dump-alias-index", cl::desc("Write alias results into an index file"),
+                                           cl::init(""), cl::value_desc("filename"));
+
+static cl::opt<std::string> ServeSocket("serve", cl::desc("Answer alias queries on a unix domain socket after analysis"),
+                                        cl::init(""), cl::value_desc("socket"));
+
+static cl::opt<unsigned> PromoteIndirectCalls("promote-indirect-calls",
+                                              cl::desc("Promote pointer calls with at most the given # resolved "
+                                                       "callees to guarded direct calls, 0 for no promotion"),
+                                              cl::init(0), cl::value_desc("num of callees"));
+
+static cl::opt<bool> InferFunctionAttrs("infer-function-attrs",
+                                        cl::desc("Infer memory, nocapture and noalias-return attributes "
+                                                 "of functions and write them into the output"),
+                                        cl::init(false));
+
+static cl::opt<unsigned> EmitAliasScopes("emit-alias-scopes",
+                                         cl::desc("Attach scoped noalias metadata to loads/stores, with at most "
+                                                  "the given # scopes per function, 0 for no metadata"),
+                                         cl::init(0), cl::value_desc("num of scopes"));
+
 int main(int argc, char **argv) {
     InitLLVM X(argc, argv);
 
@@ -107,11 +133,19 @@ int main(int argc, char **argv) {
     Passes.add(createLoopSimplifyPass());
     Passes.add(new LowerConstantExpr());
     Passes.add(TransformTimer->done());
-    if (!OutputAssembly.getValue()) {
+    // -S alone only prints the transformed bitcode, but the transforms below need the analysis results
+    bool RunTransforms = PromoteIndirectCalls.getValue() || InferFunctionAttrs.getValue() || EmitAliasScopes.getValue();
+    if (!OutputAssembly.getValue() || RunTransforms) {
         auto *AnalysisTimer = new RecursiveTimerPass("Analyzing the bitcode");
         Passes.add(AnalysisTimer->start());
         Passes.add(new NullCheckAnalysis());
         Passes.add(AnalysisTimer->done());
+        if (!AliasIndexFile.getValue().empty()) Passes.add(new AliasIndexWriter(AliasIndexFile.getValue()));
+        if (!ServeSocket.getValue().empty()) Passes.add(new AliasServer(ServeSocket.getValue()));
+        // they change the code, so they run after all clients of the analysis results
+        if (InferFunctionAttrs.getValue()) Passes.add(new FunctionAttrInference());
+        if (EmitAliasScopes.getValue()) Passes.add(new AliasScopeMetadata(EmitAliasScopes.getValue()));
+        if (PromoteIndirectCalls.getValue()) Passes.add(new IndirectCallPromotion(PromoteIndirectCalls.getValue()));
     }
 
     std::unique_ptr<ToolOutputFile> Out;
@@ -0,0 +1,52 @@
+/*
+ *  Canary features a fast unification-based alias analysis for C programs
+ *  Copyright (C) 2021 Qingkai Shi <qingkaishi@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/PassPlugin.h>
+#include "DyckAA/DyckAAResult.h"
+
+/// Registers DyckAA with the new pass manager of opt, e.g.,
+///   opt -load-pass-plugin=DyckAAPlugin.so -aa-pipeline=dyck-aa,basic-aa -passes='require<dyck-aa>,function(gvn)'
+/// function passes only see cached module analyses, so require<dyck-aa> must run before them
+static void registerDyckAA(PassBuilder &PB) {
+    PB.registerAnalysisRegistrationCallback([](ModuleAnalysisManager &MAM) {
+        MAM.registerPass([] { return DyckAA(); });
+    });
+    PB.registerParseAACallback([](StringRef Name, AAManager &AA) {
+        if (Name != "dyck-aa") return false;
+        AA.registerModuleAnalysis<DyckAA>();
+        return true;
+    });
+    PB.registerPipelineParsingCallback([](StringRef Name, ModulePassManager &MPM,
+                                          ArrayRef<PassBuilder::PipelineElement>) {
+        if (Name == "require<dyck-aa>") {
+            MPM.addPass(RequireAnalysisPass<DyckAA, Module>());
+            return true;
+        }
+        if (Name == "invalidate<dyck-aa>") {
+            MPM.addPass(InvalidateAnalysisPass<DyckAA>());
+            return true;
+        }
+        return false;
+    });
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "DyckAA", LLVM_VERSION_STRING, registerDyckAA};
+}